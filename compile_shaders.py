@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 
+import re
 import shutil
 import subprocess
 import sys
@@ -7,9 +8,57 @@ from pathlib import Path
 from subprocess import CalledProcessError
 
 
+def workgroup_sizes():
+    constants = Path(__file__).parent / "include" / "constants.h"
+    match = re.search(r"#define WORKGROUP_SIZES \{([^}]*)\}", constants.read_text())
+    return [int(size) for size in match.group(1).split(",")]
+
+
+def compile_shader(input_file, output_file, defines=()):
+    try:
+        subprocess.run([
+            "glslang",
+            "-V",
+            *defines,
+            str(input_file),
+            "-o",
+            str(output_file),
+        ], check=True)
+        # print(f"Compiled {input_file} -> {output_file}")
+    except CalledProcessError:
+        print(f"Error compiling shader at {input_file}")
+        sys.exit(1)
+
+
+def embed_shaders(out_dir, outputs, embed_file):
+    # SPIR-V is a stream of 32-bit words, so keeping it as u32 keeps the data aligned for the driver
+    lines = ['#include "embedded_shaders.h"', ""]
+    entries = []
+    for i, output_file in enumerate(outputs):
+        code = output_file.read_bytes()
+        words = [int.from_bytes(code[j:j + 4], "little") for j in range(0, len(code), 4)]
+        lines.append(f"static const u32 shader_{i}[] = {{")
+        for j in range(0, len(words), 8):
+            lines.append("    " + " ".join(f"0x{word:08x}," for word in words[j:j + 8]))
+        lines.append("};")
+        lines.append("")
+
+        path = (Path(out_dir.name) / output_file.relative_to(out_dir)).as_posix()
+        entries.append(f'    {{ "{path}", shader_{i}, {len(code)} }},')
+
+    lines.append("const EmbeddedShader EMBEDDED_SHADERS[] = {")
+    lines.extend(entries or ["    { 0 },"])
+    lines.append("};")
+    lines.append(f"const u32 EMBEDDED_SHADER_COUNT = {len(entries)};")
+    lines.append("")
+
+    embed_file.parent.mkdir(parents=True, exist_ok=True)
+    embed_file.write_text("\n".join(lines))
+
+
 def main():
-    if len(sys.argv) < 2:
-        print("provide input and output directory!")
+    if len(sys.argv) < 3:
+        print("provide input and output directory, and optionally a C file to embed the shaders into!")
         sys.exit(1)
 
     if shutil.which("glslang") is None:
@@ -19,13 +68,18 @@ def main():
 
     in_dir = Path(sys.argv[1])
     out_dir = Path(sys.argv[2])
+    embed_file = Path(sys.argv[3]) if len(sys.argv) > 3 else None
     out_dir.mkdir(parents=True, exist_ok=True)
 
     glsl_files = list(in_dir.glob("**/*.glsl"))
     if not glsl_files:
         print(f"Warning! no shader files found in {in_dir}")
+        if embed_file:
+            embed_shaders(out_dir, [], embed_file)
         sys.exit(0)
 
+    outputs = []
+
     for input_file in glsl_files:
         relative_path = input_file.relative_to(in_dir)
         output_file = (out_dir / relative_path).with_suffix(".spv")
@@ -34,18 +88,18 @@ def main():
         if ".lib" in input_file.stem:
             continue
 
-        try:
-            subprocess.run([
-                "glslang",
-                "-V",
-                str(input_file),
-                "-o",
-                str(output_file),
-            ], check=True)
-            # print(f"Compiled {input_file} -> {output_file}")
-        except CalledProcessError:
-            print(f"Error compiling shader at {input_file}")
-            sys.exit(1)
+        # compute shaders get one variant per workgroup size, picked between at runtime
+        if input_file.stem.endswith(".comp"):
+            for size in workgroup_sizes():
+                variant_file = output_file.with_suffix(f".{size}.spv")
+                compile_shader(input_file, variant_file, [f"-DWORKGROUP_SIZE={size}"])
+                outputs.append(variant_file)
+        else:
+            compile_shader(input_file, output_file)
+            outputs.append(output_file)
+
+    if embed_file:
+        embed_shaders(out_dir, outputs, embed_file)
 
 
 if __name__ == "__main__":
@@ -7,7 +7,7 @@
 #include "HandmadeMath.h"
 #include "types.h"
 
-typedef struct Simulation Simulation;
+typedef struct SimulationFrame SimulationFrame;
 typedef struct Ghost Ghost;
 
 typedef struct Camera {
@@ -20,9 +20,9 @@ typedef struct Camera {
 } Camera;
 
 void camera_init(Camera *cam);
-void camera_update(Camera *cam, SDL_Window *window, SDL_GPUDevice *gpu, const Simulation *sim);
+void camera_update(Camera *cam, SDL_Window *window, SDL_GPUDevice *gpu, const SimulationFrame *sim, f32 alpha);
 void camera_mouse(Camera *cam, const SDL_Event *event, const Ghost *ghost);
-void camera_keyboard(Camera *cam, const SDL_Event *event, const Simulation *sim);
+void camera_keyboard(Camera *cam, const SDL_Event *event, u32 body_count);
 
 HMM_Vec2 screen_to_world(const Camera *cam, HMM_Vec2 position);
 HMM_Vec2 world_to_screen(const Camera *cam, const HMM_Vec2 position);
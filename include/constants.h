@@ -10,6 +10,24 @@
 #define EPSILON 1e-6f // TODO: turn into simulation parameter?
 #define MAX_ACCUMULATOR_TIME 0.25
 
+// scheduler defaults
+#define SCHEDULER_BUDGET_DEFAULT 0.5f
+#define SCHEDULER_SMOOTHING 0.1f
+#define SCHEDULER_MIN_UNITS 8
+#define SCHEDULER_MAX_FLIGHTS 16
+#define SCHEDULER_MIN_COST 1e-6f
+
+// simulation thread
+#define SIMULATION_QUEUE_LENGTH 256
+#define SIMULATION_IDLE_WAIT 0.01f
+#define SIMULATION_HISTORY_LENGTH 64 // steps of positions kept for trails between published frames
+
+// startup
+#define SHADER_CACHE_MAX_THREADS 8
+
+// switched off visualizations
+#define RELEASE_DELAY 10.0f // seconds before their buffers are released, in case they're switched straight back on
+
 // new body defaults
 #define MASS_DEFAULT 50.0f
 #define COLOR_DEFAULT (SDL_FColor) { 1.0f, 1.0f, 1.0f, 1.0f }
@@ -19,21 +37,71 @@
 #define SOFTENING_DEFAULT 0.1f
 #define DENSITY_DEFAULT 0.001f
 #define INTEGRATOR_DEFAULT INTEGRATOR_EULER
+#define STATIC_FIELD_DEFAULT false // opt-in, it trades exact pull from fixed bodies for speed
+#define STATIC_FIELD_MIN_BODIES 64
+#define STATIC_FIELD_RESOLUTION 512
+#define STATIC_FIELD_MARGIN 0.5f
+#define TRAIL_SAMPLE_STEPS_DEFAULT 2
+#define TRAIL_SAMPLE_STEPS_MAX 64
 #define TRAJECTORY_DELTA_TIME_MULTIPLIER_DEFAULT 1.0f
-#define FIELD_LINE_VOLUME_DEFAULT 5
+#define TRAJECTORY_GHOST_EPHEMERIS_DEFAULT true
+#define TRAJECTORY_HORIZON_DEFAULT (PREDICTION_LENGTH - 1)
+#define TRAJECTORY_HORIZON_MAX 1048576
+#define TRAJECTORY_SAMPLE_DISTANCE_DEFAULT 16.0f
+#define FIELD_LINE_BUDGET_DEFAULT 256
+#define FIELD_LINE_BUDGET_MAX 4096
 #define FIELD_LINE_STEP_DEFAULT 0.5
+#define FIELD_GRID_DEFAULT 100.0f
+#define FIELD_GRID_THRESHOLD_DEFAULT 0.25f
+#define FIELD_GRID_MARGIN 8
+#define TRACER_COUNT_DEFAULT 100000
+#define TRACER_COUNT_MAX 1048576
+#define TRACER_RADIUS_DEFAULT 400.0f
+#define TRACER_MAX_BACKLOG 256 // steps the tracers may fall behind the simulation before the oldest are skipped
 
 // graphics defaults
 #define CLEAR_COLOR_DEFAULT (SDL_FColor) { 0.0f, 0.0f, 0.0f, 1.0f }
-#define FIELD_GRID_DEFAULT 100.0f
 #define MOVABLE_OUTLINE_DEFAULT 0.1f
 #define STATIC_OUTLINE_DEFAULT 1.0f
 #define TRAIL_FADE_DEFAULT 1.0f
+#define SPLAT_THRESHOLD_DEFAULT 1.0f
+#define SPLAT_EXPOSURE_DEFAULT 0.02f
+#define GRAPHICS_CULL_MARGIN 0.05f
+#define LOD_ERROR_DEFAULT 0.5f
+#define LOD_READBACK_FRAMES 3 // frames a segment count readback may take before it's read
+#define LOD_SEGMENTS_MIN 4096 // segment vertices always kept room for, so lines that appear don't wait on a readback
+#define CONTOUR_COLOR_DEFAULT (SDL_FColor) { 1.0f, 1.0f, 1.0f, 0.4f }
+#define CONTOUR_BASE_DEFAULT 0.25f
+#define CONTOUR_RATIO_DEFAULT 1.5f
+#define CONTOUR_LEVELS_DEFAULT 8
+#define CONTOUR_MAX_LEVELS 32
+#define CONTOUR_SEGMENTS_PER_LEVEL 2 // a saddle crosses its cell twice
+#define CONTOUR_BASE_MIN 1e-3f
+#define CONTOUR_RATIO_MIN 1.01f
+#define TRACER_COLOR_DEFAULT (SDL_FColor) { 0.5f, 0.7f, 1.0f, 1.0f }
+#define TRACER_EXPOSURE_DEFAULT 0.2f
 
 // fixed, compiled with shaders
 #define TRAIL_LENGTH 512
+#define TRAIL_EXTENT_MIN 1.0
 #define PREDICTION_LENGTH 2048
-#define FIELD_LINE_LENGTH 1024
+#define PREDICTION_SAMPLE_ANGLE 0.05
+#define FIELD_LINE_LENGTH 256
+#define LOD_LINE_LENGTH_MAX PREDICTION_LENGTH // the longest of the lines above, lod_lines.comp holds one in shared memory
+#define FIELD_LINE_EXTENT 1024.0
+#define FIELD_LINE_STEP_MIN 0.125
+#define FIELD_LINE_STEP_MAX 8.0
+#define FIELD_LINE_TOLERANCE 0.1
+#define SPLAT_FIXED_POINT 16.0
+#define POTENTIAL_EDGE_SIGMA 0.25
+
+// compute shaders are compiled once per workgroup size, the fastest is picked at startup
+#define WORKGROUP_SIZES { 16, 32, 64, 128, 256 }
+#define WORKGROUP_SIZE_COUNT 5
+#define WORKGROUP_SIZE_DEFAULT 64
+#define MAX_WORKGROUP_COUNT 65535
+#define AUTOTUNE_BODY_COUNT 4096
+#define AUTOTUNE_DISPATCHES 8
 
 #endif
 
@@ -0,0 +1,16 @@
+#ifndef N_BODY_EMBEDDED_SHADERS
+#define N_BODY_EMBEDDED_SHADERS
+
+#include "types.h"
+
+// compiled SPIR-V baked into the executable, generated by compile_shaders.py
+typedef struct {
+    const char *path;
+    const u32 *code;
+    usize size;
+} EmbeddedShader;
+
+extern const EmbeddedShader EMBEDDED_SHADERS[];
+extern const u32 EMBEDDED_SHADER_COUNT;
+
+#endif
@@ -2,31 +2,93 @@
 #define N_BODY_FIELD
 
 #include "sdl_utils.h"
+#include "kernel.h"
+#include "selection.h"
+#include "HandmadeMath.h"
 
-typedef struct Simulation Simulation;
+typedef struct SimulationFrame SimulationFrame;
+typedef struct Camera Camera;
+typedef struct Scheduler Scheduler;
 
 typedef struct FieldOptions {
-    f32 line_volume;
     f32 line_step;
+    i32 line_budget;
+    f32 grid_resolution;
+    f32 grid_threshold;
     bool enabled;
 } FieldOptions;
 
-typedef struct Field {
-    SDL_GPUComputePipeline *pipeline;
-    GPUArray lines;
-    GPUArray line_ids;
+// acceleration and potential over the viewport, shared by everything that samples gravity
+typedef struct FieldGrid {
+    GPUArray cells;
+    GPUArray snapshot; // body positions the grid was last computed with
+    SDL_GPUBuffer *state;
+    HMM_Vec2 origin;
+    u32 size[2];
+    f32 cell_size;
+    u64 sim_version;
+    u64 version; // bumped whenever the grid is resampled
+    u32 body_count;
+    f32 gravity;
+    f32 softening;
+    bool valid;
+} FieldGrid;
+
+// what the current field lines were traced through
+typedef struct FieldLinesState {
+    u64 grid_version;
+    FieldOptions options;
+    u64 selection_version;
     u32 line_count;
+    u32 body_count;
+    bool valid;
+} FieldLinesState;
+
+// everything a set of traced lines is drawn from
+typedef struct FieldLineBuffers {
+    GPUArray positions;
+    GPUArray distances; // arc length along the line up to each vertex
+    GPUArray vertex_counts; // how far each line got before it ended
+    GPUArray line_ids; // the body each line was seeded from, past the last seeded line there's none
+} FieldLineBuffers;
+
+typedef struct Field {
+    ComputeKernel kernel;
+    ComputeKernel seed_kernel;
+    ComputeKernel grid_kernel;
+    ComputeKernel moved_kernel;
+    FieldGrid grid;
+    FieldLineBuffers lines;
+    FieldLineBuffers pending; // lines being traced, swapped with lines once every step is done
+    GPUArray steps; // each pending line's next step size
+    GPUArray spans; // the first line and line count of each body
+    GPUArray bodies; // the selected bodies, the only ones lines are seeded from
+    Selection selection;
     FieldOptions options;
+    FieldLinesState traced;
+    FieldLinesState tracing;
+    GPUResidency grid_residency;
+    GPUResidency lines_residency;
+    u32 progress; // steps of the pending lines traced so far
+    bool busy;
 } Field;
 
-SDL_AppResult field_init(Field *field, SDL_GPUDevice *gpu);
+void field_init(Field *field);
+void field_add_body(Field *field, bool selected);
+void field_select(Field *field, u32 body, bool selected);
+typedef struct {
+    SDL_GPUDevice *gpu;
+    SDL_GPUCommandBuffer *command_buffer;
+    const SimulationFrame *sim;
+    const Camera *cam;
+    bool potential;
+} FieldGridUpdateInfo;
+void field_grid_update(Field *field, const FieldGridUpdateInfo *info);
 typedef struct {
     SDL_GPUDevice *gpu;
-    SDL_GPUCopyPass *copy_pass;
-    const f32 mass;
-    const u32 index;
-} FieldAddBodyInfo;
-void field_add_body(Field *field, const FieldAddBodyInfo *info);
-void field_update(const Field *field, const Simulation *sim, SDL_GPUCommandBuffer *command_buffer, SDL_GPUComputePass *compute_pass);
-void field_free(const Field *field, SDL_GPUDevice *gpu);
+    Scheduler *scheduler;
+    const SimulationFrame *sim;
+} FieldUpdateInfo;
+void field_update(Field *field, const FieldUpdateInfo *info);
+void field_free(Field *field, SDL_GPUDevice *gpu);
 #endif
@@ -7,12 +7,10 @@
 #include "SDL3/SDL_events.h"
 #include "SDL3/SDL_pixels.h"
 #include "HandmadeMath.h"
-#include "trajectories.h"
 #include "types.h"
 
-typedef struct Simulation Simulation;
+typedef struct SimulationFrame SimulationFrame;
 typedef struct Camera Camera;
-typedef struct Trajectories Trajectories;
 
 typedef struct Ghost {
     SDL_FColor color;
@@ -21,11 +19,14 @@ typedef struct Ghost {
     HMM_Vec2 relative_position;
     f32 mass;
     bool movable;
+    bool trail; // which visualizations the new body takes part in
+    bool trajectory;
+    bool field_lines;
     bool enabled;
 } Ghost;
 
-void ghost_init(Ghost *ghost, Trajectories *trajectories, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass);
-void ghost_update(Ghost *ghost, SDL_GPUDevice *gpu, const Simulation *sim, const Camera *cam);
+void ghost_init(Ghost *ghost);
+void ghost_update(Ghost *ghost, SDL_GPUDevice *gpu, const SimulationFrame *sim, const Camera *cam);
 bool ghost_mouse(Ghost *ghost, const SDL_Event *event);
 void ghost_keyboard(Ghost *ghost, const SDL_Event *event);
 
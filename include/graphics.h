@@ -4,12 +4,15 @@
 #include <stdbool.h>
 #include "types.h"
 #include "sdl_utils.h"
+#include "kernel.h"
+#include "constants.h"
 
-typedef struct Simulation Simulation;
+typedef struct SimulationFrame SimulationFrame;
 typedef struct Ghost Ghost;
 typedef struct Trails Trails;
 typedef struct Trajectories Trajectories;
 typedef struct Field Field;
+typedef struct Tracers Tracers;
 typedef struct Camera Camera;
 
 typedef struct {
@@ -17,10 +20,36 @@ typedef struct {
     f32 movable_outline;
     f32 static_outline;
     f32 trail_brightness;
-    bool trails;
+    f32 splat_threshold;
+    f32 splat_exposure;
+    SDL_FColor tracer_color;
+    f32 tracer_exposure;
+    f32 lod_error;
+    SDL_FColor contour_color;
+    f32 contour_base;
+    f32 contour_ratio;
+    i32 contour_levels;
     bool potential;
+    bool equipotentials;
 } GraphicsOptions;
 
+typedef enum {
+    GRAPHICS_CULL_BODIES,
+    GRAPHICS_CULL_TRAILS,
+    GRAPHICS_CULL_TRAJECTORIES,
+    GRAPHICS_CULL_FIELD,
+    GRAPHICS_CULL_COUNT,
+} GraphicsCull;
+
+// what the current equipotential lines were extracted from
+typedef struct GraphicsContourState {
+    u64 grid_version;
+    f32 base;
+    f32 ratio;
+    i32 levels;
+    bool valid;
+} GraphicsContourState;
+
 typedef struct Graphics {
     GraphicsOptions options;
     SDL_GPUGraphicsPipeline *body_pipeline;
@@ -29,28 +58,58 @@ typedef struct Graphics {
     SDL_GPUGraphicsPipeline *ghost_body_pipeline;
     SDL_GPUGraphicsPipeline *field_pipeline;
     SDL_GPUGraphicsPipeline *potential_pipeline;
+    SDL_GPUGraphicsPipeline *splat_pipeline;
+    SDL_GPUGraphicsPipeline *contour_pipeline;
+    ComputeKernel splat_clear_kernel;
+    ComputeKernel splat_kernel;
+    ComputeKernel splat_tracers_kernel;
+    ComputeKernel cull_bodies_kernel;
+    ComputeKernel lod_lines_kernel;
+    ComputeKernel contour_kernel;
     GPUArray colors;
+    GPUArray splat;
+    GPUArray tracer_splat;
+    GPUArray visible[GRAPHICS_CULL_COUNT];
+    SDL_GPUBuffer *draw_arguments;
+    SDL_GPUBuffer *line_demand; // segment vertices every line draw asked for, whether they fit or not
+    SDL_GPUTransferBuffer *demand_readbacks[LOD_READBACK_FRAMES]; // indexed by frame, read once it has finished
+    u32 demand_frames[LOD_READBACK_FRAMES];
+    bool demand_pending[LOD_READBACK_FRAMES];
+    u32 demand_frame; // the frame line_demands was read back from
+    u32 line_demands[GRAPHICS_CULL_COUNT];
+    GPUArray contours;
+    SDL_GPUBuffer *contour_arguments;
+    GraphicsContourState contoured;
+    f32 max_mass;
+    bool splatting;
+    bool contouring;
 } Graphics;
 
 SDL_AppResult graphics_init(Graphics *gfx, SDL_GPUDevice *gpu, SDL_Window *window);
 typedef struct {
     SDL_GPUDevice *gpu;
-    SDL_FColor color;
+    SDL_GPUCopyPass *copy_pass;
+    const SDL_FColor *color;
+    f32 mass;
 } GraphicsAddBodyInfo;
 
-void graphics_add_body(Graphics *gfx, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass, SDL_FColor *color);
+void graphics_add_body(Graphics *gfx, const GraphicsAddBodyInfo *info);
 typedef struct {
     SDL_Window *window;
     SDL_GPUDevice *gpu;
     SDL_GPUCommandBuffer *command_buffer;
-    const Simulation *sim;
+    const SimulationFrame *sim;
     const Ghost *ghost;
     const Trails *trails;
     const Trajectories *trajectories;
     const Field *field;
+    const Tracers *tracers;
     const Camera *cam;
+    f32 alpha;
+    u32 frame; // counted the same as the scheduler's frames
+    u32 frames_retired;
 } GraphicsDrawInfo;
-void graphics_draw(const Graphics *gfx, const GraphicsDrawInfo *info);
+void graphics_draw(Graphics *gfx, const GraphicsDrawInfo *info);
 void graphics_free(const Graphics *gfx, SDL_GPUDevice *gpu);
 
 #endif
@@ -1,11 +1,15 @@
 #ifndef N_BODY_GUI
 #define N_BODY_GUI
 
-typedef struct Simulation Simulation;
+typedef struct Scheduler Scheduler;
+typedef struct SimulationOptions SimulationOptions;
+typedef struct SimulationFrame SimulationFrame;
 typedef struct Camera Camera;
 typedef struct Ghost Ghost;
+typedef struct Trails Trails;
 typedef struct Trajectories Trajectories;
 typedef struct Field Field;
+typedef struct Tracers Tracers;
 typedef struct Graphics Graphics;
 
 #include <stdbool.h>
@@ -26,10 +30,14 @@ typedef struct {
 void gui_init(Gui *gui, SDL_Window *window, SDL_GPUDevice *gpu);
 typedef struct {
     ApplicationOptions *app;
-    Simulation *sim;
+    Scheduler *scheduler;
+    SimulationOptions *sim;
+    const SimulationFrame *frame;
     Ghost *ghost;
+    Trails *trails;
     Trajectories *trajectories;
     Field *field;
+    Tracers *tracers;
     Camera *cam;
     Graphics *gfx;
 } GuiUpdateInfo;
@@ -0,0 +1,22 @@
+#ifndef N_BODY_KERNEL
+#define N_BODY_KERNEL
+
+#include <stdbool.h>
+#include "SDL3/SDL_gpu.h"
+#include "constants.h"
+#include "types.h"
+
+#define PREF_ORGANIZATION "seabass-space"
+#define PREF_APPLICATION "n-body"
+
+// a compute shader compiled once per workgroup size, see compile_shaders.py
+typedef struct ComputeKernel {
+    SDL_GPUComputePipeline *variants[WORKGROUP_SIZE_COUNT];
+} ComputeKernel;
+
+void kernel_autotune(SDL_GPUDevice *gpu);
+bool kernel_init(ComputeKernel *kernel, SDL_GPUDevice *gpu, const char *shader_path);
+u32 kernel_bind(const ComputeKernel *kernel, SDL_GPUComputePass *compute_pass, u32 count);
+void kernel_free(const ComputeKernel *kernel, SDL_GPUDevice *gpu);
+
+#endif
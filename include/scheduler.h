@@ -0,0 +1,56 @@
+#ifndef N_BODY_SCHEDULER
+#define N_BODY_SCHEDULER
+
+#include <stdbool.h>
+#include "SDL3/SDL_gpu.h"
+#include "constants.h"
+#include "types.h"
+
+typedef struct SchedulerOptions {
+    f32 budget;
+} SchedulerOptions;
+
+typedef enum {
+    SCHEDULER_WORK_STEPS,
+    SCHEDULER_WORK_TRAJECTORIES,
+    SCHEDULER_WORK_FIELD,
+    SCHEDULER_WORK_GHOST,
+    SCHEDULER_WORK_TRACERS,
+    SCHEDULER_WORK_FRAME, // the rendered frame, only tracked so its time isn't put down to anything else
+    SCHEDULER_WORK_COUNT,
+} SchedulerWork;
+
+// a submission still on the GPU, its cost is attributed once its fence has signaled
+typedef struct SchedulerFlight {
+    SDL_GPUFence *fence;
+    SchedulerWork work;
+    u32 units;
+    u64 submitted;
+} SchedulerFlight;
+
+typedef struct Scheduler {
+    SchedulerOptions options;
+    SchedulerFlight flights[SCHEDULER_MAX_FLIGHTS]; // ring, oldest first
+    u32 flight_head;
+    u32 flight_count;
+    u64 retired; // when the last flight was seen to retire
+    u32 frames_submitted; // render frames, counted so others can tell when one of them has finished
+    u32 frames_retired;
+    f32 accumulator;
+    f32 frame_time;
+    f32 remaining;
+    f32 costs[SCHEDULER_WORK_COUNT];
+    f32 time_dilation;
+    bool behind;
+} Scheduler;
+
+void scheduler_init(Scheduler *scheduler);
+void scheduler_begin(Scheduler *scheduler, f32 delta_time);
+u32 scheduler_plan_steps(Scheduler *scheduler, f32 delta_time, f32 fixed_delta_time, bool paused);
+u32 scheduler_plan_units(Scheduler *scheduler, SchedulerWork work, u32 wanted);
+void scheduler_submit(Scheduler *scheduler, SDL_GPUDevice *gpu, SDL_GPUCommandBuffer *command_buffer, SchedulerWork work, u32 units);
+void scheduler_wait(Scheduler *scheduler, SDL_GPUDevice *gpu);
+void scheduler_submit_frame(Scheduler *scheduler, SDL_GPUDevice *gpu, SDL_GPUCommandBuffer *command_buffer);
+void scheduler_free(Scheduler *scheduler, SDL_GPUDevice *gpu);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef N_BODY_SELECTION
+#define N_BODY_SELECTION
+
+#include <stdbool.h>
+#include "types.h"
+
+#define SELECTION_NONE ((u32) -1)
+
+// which bodies opted in to a visualization, packed into slots so its buffers and dispatches only cover those.
+// removing a body moves the last slot into its place, so the slots stay dense
+typedef struct Selection {
+    u32 *slots; // stb_ds array, each body's slot or SELECTION_NONE
+    u32 *bodies; // stb_ds array, the body in each slot
+    u64 version; // bumped whenever a body joins or leaves
+} Selection;
+
+void selection_add_body(Selection *selection, bool selected);
+u32 selection_insert(Selection *selection, u32 body);
+u32 selection_remove(Selection *selection, u32 body);
+u32 selection_slot(const Selection *selection, u32 body);
+u32 selection_count(const Selection *selection);
+bool selection_contains(const Selection *selection, u32 body);
+void selection_free(Selection *selection);
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef N_BODY_SHADER_CACHE
+#define N_BODY_SHADER_CACHE
+
+#include <stdbool.h>
+#include "SDL3/SDL_gpu.h"
+#include "types.h"
+
+// cross-compiled shaders are kept on disk keyed by a hash of their SPIR-V and the backend format
+typedef struct {
+    const char *path;
+    SDL_GPUShader *shader; // set for `.vert` and `.frag` shaders
+    SDL_GPUComputePipeline *pipeline; // set for `.comp` shaders
+} ShaderCacheLoad;
+
+typedef void (*ShaderCacheJob)(void *data, u32 index);
+
+void shader_cache_init(SDL_GPUDevice *gpu);
+bool shader_cache_load(SDL_GPUDevice *gpu, ShaderCacheLoad *loads, u32 count);
+void shader_cache_parallel(ShaderCacheJob job, void *data, u32 count);
+void shader_cache_free(void);
+
+#endif
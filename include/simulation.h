@@ -5,9 +5,10 @@
 #include "SDL3/SDL_gpu.h"
 #include "HandmadeMath.h"
 #include "sdl_utils.h"
+#include "kernel.h"
 #include "types.h"
 
-typedef struct {
+typedef struct SimulationOptions {
     enum {
         INTEGRATOR_EULER,
         INTEGRATOR_VERLET,
@@ -16,12 +17,31 @@ typedef struct {
     f32 gravity;
     f32 softening;
     f32 density;
+    bool static_field;
+    bool history; // keep every step's positions for the trails
     bool paused;
 } SimulationOptions;
 
+// static bodies' pull, sampled onto a grid around them once there are enough of them to be worth it
+typedef struct SimulationStaticField {
+    ComputeKernel kernel;
+    GPUArray grid;
+    HMM_Vec2 min;
+    HMM_Vec2 max;
+    HMM_Vec2 center; // center of mass, where the field is taken from past the grid's edge
+    f32 mass;
+    HMM_Vec2 origin;
+    u32 size[2];
+    f32 cell;
+    f32 gravity; // the options the grid was sampled with
+    f32 softening;
+    bool dirty;
+    bool cached;
+} SimulationStaticField;
+
 typedef struct Simulation {
     SimulationOptions options;
-    SDL_GPUComputePipeline *integrators[3];
+    ComputeKernel integrators[3];
 
     enum {
         SIM_POSITIONS_A,
@@ -33,8 +53,44 @@ typedef struct Simulation {
     GPUArray masses;
     GPUArray movable;
     u32 body_count;
+    u64 step;
+
+    // a ring of SIMULATION_HISTORY_LENGTH rows of positions, one per step, valid for the steps after history_start
+    ComputeKernel history_kernel;
+    GPUArray history;
+    u32 history_body_count;
+    u64 history_start;
+
+    // bodies are stored in the order they were added, these split them so only movable ones are integrated
+    GPUArray movable_indices;
+    GPUArray static_positions;
+    GPUArray static_masses;
+    SimulationStaticField static_field;
+    u32 movable_count;
+    u32 static_count;
 } Simulation;
 
+// a completed simulation state, published for everything downstream of the simulation to read
+typedef struct SimulationFrame {
+    SimulationOptions options;
+    GPUArray positions;
+    GPUArray previous_positions;
+    GPUArray velocities;
+    GPUArray masses;
+    GPUArray movable;
+    GPUArray history; // positions after each step from history_step on, oldest first
+    u32 history_count;
+    u64 history_step;
+    u32 body_count;
+    u64 step;
+    u64 version; // bumped on every publish, anything derived from the frame compares against it
+    u64 tick;
+    f32 accumulator;
+    f32 delta_time;
+    f32 time_dilation;
+    bool behind;
+} SimulationFrame;
+
 SDL_AppResult simulation_init(Simulation *sim, SDL_GPUDevice *gpu);
 typedef struct {
     HMM_Vec2 position;
@@ -45,7 +101,15 @@ typedef struct {
 
 u32 simulation_add_body(Simulation *sim, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass,
                         const SimulationAddBodyInfo *body);
+void simulation_static_update(Simulation *sim, SDL_GPUDevice *gpu, SDL_GPUCommandBuffer *command_buffer);
 void simulation_update(Simulation *sim, SDL_GPUCommandBuffer *command_buffer, SDL_GPUComputePass *compute_pass, f32 delta_time);
+SDL_GPUBuffer *simulation_positions(const Simulation *sim);
+SDL_GPUBuffer *simulation_previous_positions(const Simulation *sim);
+void simulation_frame_init(SimulationFrame *frame, SDL_GPUDevice *gpu);
+void simulation_history_reserve(Simulation *sim, SDL_GPUDevice *gpu);
+void simulation_publish(const Simulation *sim, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass, SimulationFrame *frame, u64 since);
+f32 simulation_frame_alpha(const SimulationFrame *frame, u64 tick);
+void simulation_frame_free(const SimulationFrame *frame, SDL_GPUDevice *gpu);
 void simulation_free(const Simulation *sim, SDL_GPUDevice *gpu);
 
 #endif
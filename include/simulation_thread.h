@@ -0,0 +1,65 @@
+#ifndef N_BODY_SIMULATION_THREAD
+#define N_BODY_SIMULATION_THREAD
+
+#include "SDL3/SDL_gpu.h"
+#include "SDL3/SDL_thread.h"
+#include "SDL3/SDL_mutex.h"
+#include "SDL3/SDL_atomic.h"
+#include "constants.h"
+#include "simulation.h"
+#include "scheduler.h"
+#include "types.h"
+
+typedef struct {
+    enum {
+        SIMULATION_COMMAND_ADD_BODY,
+        SIMULATION_COMMAND_OPTIONS,
+    } type;
+    union {
+        SimulationAddBodyInfo body;
+        struct {
+            SimulationOptions sim;
+            SchedulerOptions scheduler;
+            f32 fixed_delta_time;
+        } options;
+    };
+} SimulationCommand;
+
+typedef struct SimulationThread {
+    Simulation sim;
+    Scheduler scheduler;
+    f32 fixed_delta_time;
+    SDL_GPUDevice *gpu;
+    SDL_Thread *thread;
+    SDL_Semaphore *wake;
+    SDL_AtomicInt quit;
+
+    // single producer (the render thread) single consumer (the simulation thread) ring
+    SimulationCommand commands[SIMULATION_QUEUE_LENGTH];
+    SDL_AtomicInt head;
+    SDL_AtomicInt tail;
+
+    SimulationCommand sent; // the options last pushed, they're only pushed again once they change
+
+    // triple buffer: one frame being written, one being drawn, and the latest completed one waiting in between.
+    // a frame handed back can still be read by rendering the GPU hasn't finished, so each remembers the last render
+    // frame that read it and isn't written again until that one has retired
+    SimulationFrame frames[3];
+    u32 readers[3];
+    SDL_AtomicU32 retired;
+    SDL_AtomicInt ready;
+    u32 write;
+    u32 read;
+    u64 version;
+    u64 published; // the step of the last frame published
+    u64 consumed; // the step of the last frame the render thread is known to have picked up
+} SimulationThread;
+
+SDL_AppResult simulation_thread_init(SimulationThread *thread, SDL_GPUDevice *gpu);
+bool simulation_thread_push(SimulationThread *thread, const SimulationCommand *command);
+void simulation_thread_push_options(SimulationThread *thread, const SimulationOptions *sim, const SchedulerOptions *scheduler, f32 fixed_delta_time);
+const SimulationFrame *simulation_thread_acquire(SimulationThread *thread, u32 render_frame);
+void simulation_thread_retire(SimulationThread *thread, u32 render_frame);
+void simulation_thread_free(SimulationThread *thread, SDL_GPUDevice *gpu);
+
+#endif
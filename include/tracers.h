@@ -0,0 +1,44 @@
+#ifndef N_BODY_TRACERS
+#define N_BODY_TRACERS
+
+#include "sdl_utils.h"
+#include "kernel.h"
+#include "HandmadeMath.h"
+
+typedef struct SimulationFrame SimulationFrame;
+typedef struct Scheduler Scheduler;
+
+typedef struct TracerOptions {
+    i32 count;
+    f32 radius;
+    bool enabled;
+} TracerOptions;
+
+// massless test particles, pulled along by the bodies without pulling back
+typedef struct Tracers {
+    ComputeKernel kernel;
+    ComputeKernel seed_kernel;
+    ComputeKernel barycenter_kernel;
+    GPUArray positions;
+    GPUArray velocities;
+    SDL_GPUBuffer *barycenter; // of the bodies when the tracers were last seeded, reduced on the GPU
+    TracerOptions options;
+    GPUResidency residency;
+    u32 count;
+    u32 seed;
+    u64 step; // the simulation step the tracers have been advanced to
+    bool seeded;
+} Tracers;
+
+void tracers_init(Tracers *tracers);
+typedef struct {
+    SDL_GPUDevice *gpu;
+    SDL_GPUCommandBuffer *command_buffer;
+    Scheduler *scheduler;
+    const SimulationFrame *sim;
+} TracersUpdateInfo;
+void tracers_update(Tracers *tracers, const TracersUpdateInfo *info);
+void tracers_reseed(Tracers *tracers);
+void tracers_free(Tracers *tracers, SDL_GPUDevice *gpu);
+
+#endif
@@ -2,20 +2,56 @@
 #define N_BODY_TRAILS
 
 #include "sdl_utils.h"
+#include "kernel.h"
+#include "selection.h"
 #include "HandmadeMath.h"
 
-typedef struct Simulation Simulation;
+typedef struct SimulationFrame SimulationFrame;
 
+// a body joining or leaving the trails, held until the next update so it lands between frames
+typedef struct TrailsRequest {
+    HMM_Vec2 position; // where a joining body's trail starts out
+    u32 body;
+    bool selected;
+} TrailsRequest;
+
+typedef struct TrailOptions {
+    bool enabled;
+    i32 sample_steps; // simulation steps between trail points
+} TrailOptions;
+
+// trail points are stored as 16 bit offsets (snorm16x2) from this, decoded with trail.lib.glsl
+typedef struct TrailAnchor {
+    HMM_Vec2 origin;
+    f32 extent;
+    f32 padding;
+} TrailAnchor;
+
+// only the selected bodies have a trail, array, anchors and bodies are all indexed by their slot. they're only
+// allocated while resident, trails carry on while switched off until they're released
 typedef struct Trails {
-    SDL_GPUComputePipeline *pipeline;
+    ComputeKernel kernel;
     GPUArray array;
+    GPUArray anchors;
+    GPUArray bodies; // the body each trail belongs to
+    Selection selection;
+    TrailsRequest *requests; // stb_ds array
+    TrailOptions options;
+    GPUResidency residency;
     u32 frame;
+    u64 step; // the simulation step of the newest point
 } Trails;
 
-SDL_AppResult trails_init(Trails *trails, SDL_GPUDevice *gpu);
+void trails_init(Trails *trails);
 
-void trails_add_body(Trails *trails, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass, HMM_Vec2 position);
-void trails_update(Trails *trails, SDL_GPUCommandBuffer *command_buffer, SDL_GPUComputePass *compute_pass, const Simulation *sim);
-void trails_free(const Trails *trails, SDL_GPUDevice *gpu);
+void trails_add_body(Trails *trails, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass, HMM_Vec2 position, bool selected);
+void trails_select(Trails *trails, u32 body, HMM_Vec2 position, bool selected);
+typedef struct {
+    SDL_GPUDevice *gpu;
+    SDL_GPUCommandBuffer *command_buffer;
+    const SimulationFrame *sim;
+} TrailsUpdateInfo;
+void trails_update(Trails *trails, const TrailsUpdateInfo *info);
+void trails_free(Trails *trails, SDL_GPUDevice *gpu);
 
 #endif
@@ -2,40 +2,115 @@
 #define N_BODY_TRAJECTORY
 
 #include "sdl_utils.h"
+#include "kernel.h"
+#include "selection.h"
+#include "HandmadeMath.h"
 
-typedef struct Simulation Simulation;
+typedef struct SimulationFrame SimulationFrame;
 typedef struct Ghost Ghost;
+typedef struct Scheduler Scheduler;
 
 typedef struct TrajectoryOptions {
+    i32 horizon; // steps predicted ahead
+    f32 sample_distance; // the furthest a prediction goes between vertices, unless it turns first
     f32 delta_time_multiplier;
+    bool ghost_ephemeris; // predict the ghost on its own, as a test particle, against the bodies' cached predictions
     bool enabled;
 } TrajectoryOptions;
 
-typedef struct Trajectories {
-    SDL_GPUComputePipeline *pipeline;
+// what the current predictions were computed from, they're only redone once any of it changes
+typedef struct TrajectoriesState {
+    u64 sim_version;
+    TrajectoryOptions options;
+    HMM_Vec2 ghost_position;
+    HMM_Vec2 ghost_velocity;
+    f32 ghost_mass;
+    f32 delta_time;
+    f32 gravity;
+    f32 softening;
+    u64 selection_version;
+    u32 body_count;
+    u32 count; // bodies with a prediction kept, the ghost's comes after them
+    u32 target; // followed without being selected, so it's kept too
+    u32 horizon;
+    bool ghost;
+    bool all; // every body is kept for the ghost to be predicted through
+    bool valid;
+} TrajectoriesState;
+
+// predictions are integrated every step but only keep a vertex once they've turned or travelled far enough, so
+// each one is a list of up to PREDICTION_LENGTH vertices, the step each was kept at and how many there are.
+// every body is integrated but only the selected ones keep vertices, each in its own slot
+typedef struct TrajectoryBuffers {
     GPUArray positions;
+    GPUArray times;
+    GPUArray vertex_counts;
+    GPUArray bodies; // the body in each slot, the ghost's slot has none
+    u32 *slots; // stb_ds array, each body's slot or SELECTION_NONE
+} TrajectoryBuffers;
+
+// the ghost's own prediction, redone whenever it's dragged or a new set of body predictions is swapped in. it's
+// integrated a slice of steps per frame like the bodies' jobs, and drawn as far as it has got
+typedef struct TrajectoriesGhostState {
+    HMM_Vec2 position;
+    HMM_Vec2 velocity;
+    u64 generation;
+    u32 progress;
+    bool valid;
+} TrajectoriesGhostState;
+
+// which of the predictions are drawn. with every body predicted for the ghost only the selected and followed ones
+// are, so their slots are listed apart and relisted whenever anything that picks them changes
+typedef struct TrajectoriesDrawn {
+    u64 generation;
+    u64 selection_version;
+    u32 target;
+    u32 count; // slots listed, the ghost's last if it's drawn
+    bool ghost;
+    bool valid;
+} TrajectoriesDrawn;
+
+// predictions are integrated a slice at a time into pending, and only swapped into positions once complete
+typedef struct Trajectories {
+    ComputeKernel kernel;
+    ComputeKernel ghost_kernel;
+    TrajectoryBuffers predicted;
+    TrajectoryBuffers pending;
     GPUArray velocities;
+    GPUArray state; // the latest two steps of every prediction
+    GPUArray samples; // where and which way each prediction last kept a vertex
+    GPUArray cursors; // the ghost's place in every body's prediction
+    GPUArray ghost_state; // the ghost where the last slice of its prediction left it
+    GPUArray slots; // the pending job's slot for every body
+    GPUArray drawn_slots; // the predicted slots that are drawn
+    Selection selection;
     TrajectoryOptions options;
+    TrajectoriesState computed;
+    TrajectoriesState computing;
+    TrajectoriesGhostState ghost;
+    TrajectoriesDrawn drawn;
+    GPUResidency residency;
+    u64 generation; // bumped every time a finished job is swapped in
+    u32 progress; // steps of the pending job integrated so far
+    bool busy;
 } Trajectories;
 
-SDL_AppResult trajectories_init(Trajectories *trajectories, SDL_GPUDevice *gpu);
-void trajectories_add_body(Trajectories *trajectories, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass);
+void trajectories_init(Trajectories *trajectories);
+void trajectories_add_body(Trajectories *trajectories, bool selected);
+void trajectories_select(Trajectories *trajectories, u32 body, bool selected);
 typedef struct {
-    SDL_GPUCommandBuffer *command_buffer;
-    SDL_GPUComputePass *compute_pass;
-    const Simulation *sim;
+    SDL_GPUDevice *gpu;
+    Scheduler *scheduler;
+    const SimulationFrame *sim;
     const Ghost *ghost;
     f32 delta_time;
+    u32 target;
 } TrajectoriesUpdateInfo;
-void trajectories_update(const Trajectories *trajectories, TrajectoriesUpdateInfo *info);
-typedef struct {
-    const Ghost *ghost;
-    const Simulation *sim;
-    SDL_GPUDevice *gpu;
-    SDL_GPUCommandBuffer *command_buffer;
-} TrajectoriesGhostUpdateInfo;
-void trajectories_ghost_update(const Trajectories *trajectories, const TrajectoriesGhostUpdateInfo *info);
-void trajectories_free(const Trajectories *trajectories, SDL_GPUDevice *gpu);
+void trajectories_update(Trajectories *trajectories, const TrajectoriesUpdateInfo *info);
+u32 trajectories_count(const Trajectories *trajectories);
+u32 trajectories_slot(const Trajectories *trajectories, u32 body);
+u32 trajectories_steps(const TrajectoriesState *state);
+void trajectories_free(Trajectories *trajectories, SDL_GPUDevice *gpu);
 
 #endif
 
@@ -3,6 +3,7 @@
 
 #include "types.h"
 #include "SDL3/SDL_gpu.h"
+#include "SDL3/SDL_timer.h"
 #include "SDL3_shadercross/SDL_shadercross.h"
 
 #define SDL_GPU_BUFFERUSAGE_READDRAW (SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ)
@@ -19,76 +20,16 @@ static SDL_GPUColorTargetBlendState BLEND_STATE = {
     .dst_alpha_blendfactor = SDL_GPU_BLENDFACTOR_ONE_MINUS_SRC_ALPHA
 };
 
-static inline SDL_GPUShader *LoadSPIRVShader(SDL_GPUDevice *gpu, const char *shader_path) {
-    SDL_ShaderCross_ShaderStage stage;
-    if (SDL_strstr(shader_path, ".vert")) stage = SDL_SHADERCROSS_SHADERSTAGE_VERTEX;
-    else if (SDL_strstr(shader_path, ".frag")) stage = SDL_SHADERCROSS_SHADERSTAGE_FRAGMENT;
-    else {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_strstr() in LoadSPIRVShader(): Shader at path %s must include `.vert` or `.frag` to determine shader type.\n", shader_path);
-        return NULL;
-    }
-
-    usize shader_size;
-    const void *shader_code = SDL_LoadFile(shader_path, &shader_size);
-    if (shader_code == NULL) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_LoadFile() in LoadSPIRVShader(): Couldn't find shader at path %s.\n", shader_path);
-        return NULL;
-    }
-
-    const SDL_ShaderCross_GraphicsShaderMetadata *metadata = SDL_ShaderCross_ReflectGraphicsSPIRV(shader_code, shader_size, 0);
-    SDL_GPUShader *shader = SDL_ShaderCross_CompileGraphicsShaderFromSPIRV(gpu, &(SDL_ShaderCross_SPIRV_Info) {
-        .bytecode = shader_code,
-        .bytecode_size = shader_size,
-        .entrypoint = "main",
-        .shader_stage = stage,
-    }, &metadata->resource_info, 0);
-
-    SDL_free((void *) shader_code);
-    SDL_free((void *) metadata);
-    return shader;
-}
-
-static inline void PrintSPIRVShader(const char *shader_path) {
-    SDL_ShaderCross_ShaderStage stage;
-    if (SDL_strstr(shader_path, ".vert")) stage = SDL_SHADERCROSS_SHADERSTAGE_VERTEX;
-    else if (SDL_strstr(shader_path, ".frag")) stage = SDL_SHADERCROSS_SHADERSTAGE_FRAGMENT;
-    else if (SDL_strstr(shader_path, ".comp")) stage = SDL_SHADERCROSS_SHADERSTAGE_COMPUTE;
-    else {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_strstr() in PrintSPIRVShader(): Shader at path %s must include `.vert` or `.frag` to determine shader type.\n", shader_path);
-        return;
-    }
-
-    usize shader_size;
-    const void *shader_code = SDL_LoadFile(shader_path, &shader_size);
-    if (shader_code == NULL) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_LoadFile() in PrintSPIRVShader(): Couldn't find shader at path %s.\n", shader_path);
-        return;
-    }
-
-    char *metal = SDL_ShaderCross_TranspileMSLFromSPIRV(&(SDL_ShaderCross_SPIRV_Info) {
-        .bytecode = shader_code,
-        .bytecode_size = shader_size,
-        .entrypoint = "main",
-        .shader_stage = stage,
-    });
-
-    printf("%s\n--------\n%s\n", shader_path, metal);
-    SDL_free(metal);
-    SDL_free((void *) shader_code);
-}
-
 typedef struct {
     SDL_Window *window;
-    const char *vertex_shader_path;
-    const char *fragment_shader_path;
+    SDL_GPUShader *vertex_shader;
+    SDL_GPUShader *fragment_shader;
     SDL_GPUPrimitiveType primitive_type;
 } CreateGPUGraphicsPipelineInfo;
 static inline SDL_GPUGraphicsPipeline *CreateGPUGraphicsPipeline(SDL_GPUDevice *gpu, const CreateGPUGraphicsPipelineInfo *info) {
-    SDL_GPUShader *vertex_shader = LoadSPIRVShader(gpu, info->vertex_shader_path);
-    SDL_GPUShader *fragment_shader = LoadSPIRVShader(gpu, info->fragment_shader_path);
-    SDL_GPUGraphicsPipeline *pipeline = SDL_CreateGPUGraphicsPipeline(gpu, &(SDL_GPUGraphicsPipelineCreateInfo) {
-        .vertex_shader = vertex_shader,
-        .fragment_shader = fragment_shader,
+    return SDL_CreateGPUGraphicsPipeline(gpu, &(SDL_GPUGraphicsPipelineCreateInfo) {
+        .vertex_shader = info->vertex_shader,
+        .fragment_shader = info->fragment_shader,
         .primitive_type = info->primitive_type,
         .target_info = (SDL_GPUGraphicsPipelineTargetInfo) {
             .num_color_targets = 1,
@@ -98,27 +39,6 @@ static inline SDL_GPUGraphicsPipeline *CreateGPUGraphicsPipeline(SDL_GPUDevice *
             }
         }
     });
-
-    SDL_ReleaseGPUShader(gpu, vertex_shader);
-    SDL_ReleaseGPUShader(gpu, fragment_shader);
-    return pipeline;
-}
-
-static inline SDL_GPUComputePipeline *CreateGPUComputePipeline(SDL_GPUDevice *gpu, const char *shader_path) {
-    size_t shader_size;
-    const void *shader_code = SDL_LoadFile(shader_path, &shader_size);
-    if (shader_code == NULL) {
-        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "SDL_LoadFile() in CreateGPUComputePipeline(): Couldn't find shader at path %s.\n", shader_path);
-        return NULL;
-    }
-
-    const SDL_ShaderCross_ComputePipelineMetadata *metadata = SDL_ShaderCross_ReflectComputeSPIRV(shader_code, shader_size, 0);
-    return SDL_ShaderCross_CompileComputePipelineFromSPIRV(gpu, &(SDL_ShaderCross_SPIRV_Info) {
-        .bytecode = shader_code,
-        .bytecode_size = shader_size,
-        .entrypoint = "main",
-        .shader_stage = SDL_SHADERCROSS_SHADERSTAGE_COMPUTE,
-    }, metadata, 0);
 }
 
 typedef struct {
@@ -245,6 +165,15 @@ static inline void ExpandGPUArray(GPUArray *array, SDL_GPUDevice *gpu, SDL_GPUCo
     SDL_ReleaseGPUBuffer(gpu, old_buffer);
 }
 
+static inline void ReserveGPUArray(GPUArray *array, SDL_GPUDevice *gpu, const u32 size) {
+    if (size <= array->info.size) return;
+
+    // contents are discarded, only for arrays that get fully rewritten
+    SDL_ReleaseGPUBuffer(gpu, array->buffer);
+    array->info.size = size > 2 * array->info.size ? size : 2 * array->info.size;
+    array->buffer = SDL_CreateGPUBuffer(gpu, &array->info);
+}
+
 typedef struct {
     GPUArray *array;
     const u8 *source;
@@ -270,6 +199,20 @@ static inline void AppendGPUArrays(SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pas
     SDL_free(upload_bindings);
 }
 
+// a feature only creates its pipelines once it's first switched on, and only holds its buffers while resident
+typedef struct {
+    u64 disabled_at;
+    bool loaded; // pipelines are kept once created
+    bool resident;
+} GPUResidency;
+
+// whether a resident feature has been switched off for long enough that its buffers should be released
+static inline bool GPUResidencyExpired(GPUResidency *residency, const bool enabled, const f32 delay) {
+    const u64 now = SDL_GetTicksNS();
+    if (enabled) residency->disabled_at = now;
+    return residency->resident && !enabled && now - residency->disabled_at >= (u64) (delay * SDL_NS_PER_SECOND);
+}
+
 // TODO: get better error handling in here
 #define panic(message) do { \
     SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "%s:%d: %s\n", __FILE__, __LINE__, message); \
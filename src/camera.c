@@ -9,13 +9,25 @@ void camera_init(Camera *cam) {
     cam->target = (u32) -1;
 }
 
-void camera_update(Camera *cam, SDL_Window *window, SDL_GPUDevice *gpu, const Simulation *sim) {
-    if (cam->target != (u32) -1) ReadFromGPUBufferNow(gpu, &(ReadGPUBufferBinding) {
-        .buffer = sim->positions_a.buffer,
-        .buffer_offset = cam->target * sizeof(HMM_Vec2),
-        .destination = (u8*) &cam->position,
-        .size = sizeof(HMM_Vec2)
-    }, 1);
+void camera_update(Camera *cam, SDL_Window *window, SDL_GPUDevice *gpu, const SimulationFrame *sim, const f32 alpha) {
+    if (cam->target < sim->body_count) {
+        HMM_Vec2 previous, current;
+        ReadFromGPUBufferNow(gpu, (ReadGPUBufferBinding[]) {
+            {
+                .buffer = sim->previous_positions.buffer,
+                .buffer_offset = cam->target * sizeof(HMM_Vec2),
+                .destination = (u8*) &previous,
+                .size = sizeof(HMM_Vec2)
+            },
+            {
+                .buffer = sim->positions.buffer,
+                .buffer_offset = cam->target * sizeof(HMM_Vec2),
+                .destination = (u8*) &current,
+                .size = sizeof(HMM_Vec2)
+            },
+        }, 2);
+        cam->position = HMM_LerpV2(previous, alpha, current);
+    }
 
     i32 width, height;
     SDL_GetWindowSize(window, &width, &height);
@@ -57,10 +69,10 @@ void camera_mouse(Camera *cam, const SDL_Event *event, const Ghost *ghost) {
     }
 }
 
-void camera_keyboard(Camera *cam, const SDL_Event *event, const Simulation *sim) {
-    if (event->type != SDL_EVENT_KEY_DOWN) return;
-    if (event->key.scancode == SDL_SCANCODE_RIGHTBRACKET) cam->target = (cam->target + 1) % sim->body_count;
-    if (event->key.scancode == SDL_SCANCODE_LEFTBRACKET) cam->target = (cam->target - 1 + sim->body_count) % sim->body_count;
+void camera_keyboard(Camera *cam, const SDL_Event *event, const u32 body_count) {
+    if (event->type != SDL_EVENT_KEY_DOWN || !body_count) return;
+    if (event->key.scancode == SDL_SCANCODE_RIGHTBRACKET) cam->target = (cam->target + 1) % body_count;
+    if (event->key.scancode == SDL_SCANCODE_LEFTBRACKET) cam->target = (cam->target - 1 + body_count) % body_count;
 }
 
 HMM_Vec2 screen_to_world(const Camera *cam, HMM_Vec2 position) {
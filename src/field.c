@@ -1,83 +1,419 @@
 #include "field.h"
 #include "constants.h"
 #include "simulation.h"
+#include "camera.h"
+#include "scheduler.h"
 
 #include "HandmadeMath.h"
 
-SDL_AppResult field_init(Field *field, SDL_GPUDevice *gpu) {
-    field->pipeline = CreateGPUComputePipeline(gpu, "shaders/field.comp.spv");
-    if (!field->pipeline) panic("Failed to create field lines compute pipeline!");
+static bool field_line_buffers_init(FieldLineBuffers *buffers, SDL_GPUDevice *gpu) {
+    *buffers = (FieldLineBuffers) {
+        .positions = CreateGPUArray(gpu, FIELD_LINE_LENGTH * sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW),
+        .distances = CreateGPUArray(gpu, FIELD_LINE_LENGTH * sizeof(f32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW),
+        .vertex_counts = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW),
+        .line_ids = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW)
+    };
+    return buffers->positions.buffer && buffers->distances.buffer && buffers->vertex_counts.buffer && buffers->line_ids.buffer;
+}
 
-    field->lines = CreateGPUArray(gpu, FIELD_LINE_LENGTH * sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
-    field->line_ids = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
-    if (!field->lines.buffer) panic("Failed to create field lines storage buffer!");
-    if (!field->line_ids.buffer) panic("Failed to create field line IDs storage buffer!");
+// every job reseeds from scratch, so the pending lines only ever need room for the budget
+static void field_line_buffers_reserve(FieldLineBuffers *buffers, SDL_GPUDevice *gpu, const u32 line_count) {
+    ReserveGPUArray(&buffers->positions, gpu, line_count * FIELD_LINE_LENGTH * sizeof(HMM_Vec2));
+    ReserveGPUArray(&buffers->distances, gpu, line_count * FIELD_LINE_LENGTH * sizeof(f32));
+    ReserveGPUArray(&buffers->vertex_counts, gpu, line_count * sizeof(u32));
+    ReserveGPUArray(&buffers->line_ids, gpu, line_count * sizeof(u32));
+}
+
+static void field_line_buffers_free(const FieldLineBuffers *buffers, SDL_GPUDevice *gpu) {
+    SDL_ReleaseGPUBuffer(gpu, buffers->positions.buffer);
+    SDL_ReleaseGPUBuffer(gpu, buffers->distances.buffer);
+    SDL_ReleaseGPUBuffer(gpu, buffers->vertex_counts.buffer);
+    SDL_ReleaseGPUBuffer(gpu, buffers->line_ids.buffer);
+}
 
-    field->line_count = 0;
+void field_init(Field *field) {
+    field->selection = (Selection) { 0 };
+    field->grid = (FieldGrid) { .valid = false };
+    field->grid_residency = (GPUResidency) { 0 };
+    field->lines_residency = (GPUResidency) { 0 };
+    field->traced = (FieldLinesState) { .valid = false };
+    field->busy = false;
     field->options = (FieldOptions) {
         .line_step = FIELD_LINE_STEP_DEFAULT,
-        .line_volume = FIELD_LINE_VOLUME_DEFAULT
+        .line_budget = FIELD_LINE_BUDGET_DEFAULT,
+        .grid_resolution = FIELD_GRID_DEFAULT,
+        .grid_threshold = FIELD_GRID_THRESHOLD_DEFAULT
     };
+}
+
+// the grid is shared by the field lines and the potential, and only loaded while either is shown
+static SDL_AppResult field_grid_load(Field *field, SDL_GPUDevice *gpu) {
+    if (!field->grid_residency.loaded) {
+        if (!kernel_init(&field->grid_kernel, gpu, "shaders/field_grid.comp")) panic("Failed to create field grid compute pipeline!");
+        if (!kernel_init(&field->moved_kernel, gpu, "shaders/field_grid_moved.comp")) panic("Failed to create field grid movement compute pipeline!");
+        field->grid_residency.loaded = true;
+    }
 
+    field->grid = (FieldGrid) {
+        .cells = CreateGPUArray(gpu, sizeof(HMM_Vec4), SDL_GPU_BUFFERUSAGE_READWRITEDRAW),
+        .snapshot = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW),
+        .state = SDL_CreateGPUBuffer(gpu, &(SDL_GPUBufferCreateInfo) {
+            .usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+            .size = sizeof(u32)
+        }),
+        .version = field->grid.version
+    };
+    if (!field->grid.cells.buffer) panic("Failed to create field grid storage buffer!");
+    if (!field->grid.snapshot.buffer) panic("Failed to create field grid snapshot storage buffer!");
+    if (!field->grid.state) panic("Failed to create field grid state storage buffer!");
+    field->grid_residency.resident = true;
     return SDL_APP_CONTINUE;
 }
 
-void field_add_body(Field *field, const FieldAddBodyInfo *info) {
-    const u32 line_count = (u32) (info->mass / field->options.line_volume);
-    const usize lines_size = line_count * FIELD_LINE_LENGTH * sizeof(HMM_Vec2);
-    ExpandGPUArray(&field->lines, info->gpu, info->copy_pass, lines_size);
-    field->lines.used += lines_size;
-
-    u32 *line_ids = SDL_malloc(line_count * sizeof(u32));
-    for (u32 i = 0; i < line_count; i++) line_ids[i] = info->index;
-    AppendGPUArrays(info->gpu, info->copy_pass, &(AppendGPUArrayBinding) {
-        .array = &field->line_ids,
-        .source = (u8*) line_ids,
-        .size = line_count * sizeof(u32)
-    }, 1);
-    SDL_free(line_ids);
+static void field_grid_release(Field *field, SDL_GPUDevice *gpu) {
+    SDL_ReleaseGPUBuffer(gpu, field->grid.cells.buffer);
+    SDL_ReleaseGPUBuffer(gpu, field->grid.snapshot.buffer);
+    SDL_ReleaseGPUBuffer(gpu, field->grid.state);
+    field->grid = (FieldGrid) { .version = field->grid.version, .valid = false };
+    field->grid_residency.resident = false;
+}
+
+// lines are reseeded from the selection every job, so nothing needs catching up after a release
+static SDL_AppResult field_lines_load(Field *field, SDL_GPUDevice *gpu) {
+    if (!field->lines_residency.loaded) {
+        if (!kernel_init(&field->kernel, gpu, "shaders/field.comp")) panic("Failed to create field lines compute pipeline!");
+        if (!kernel_init(&field->seed_kernel, gpu, "shaders/field_seed.comp")) panic("Failed to create field line seeding compute pipeline!");
+        field->lines_residency.loaded = true;
+    }
+
+    if (!field_line_buffers_init(&field->lines, gpu)) panic("Failed to create field line storage buffers!");
+    if (!field_line_buffers_init(&field->pending, gpu)) panic("Failed to create pending field line storage buffers!");
+    field->steps = CreateGPUArray(gpu, sizeof(f32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    field->spans = CreateGPUArray(gpu, 2 * sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    field->bodies = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    if (!field->steps.buffer) panic("Failed to create field line steps storage buffer!");
+    if (!field->spans.buffer) panic("Failed to create field line spans storage buffer!");
+    if (!field->bodies.buffer) panic("Failed to create field line bodies storage buffer!");
+    field->lines_residency.resident = true;
+    return SDL_APP_CONTINUE;
+}
 
-    field->line_count += line_count;
+static void field_lines_release(Field *field, SDL_GPUDevice *gpu) {
+    field_line_buffers_free(&field->lines, gpu);
+    field_line_buffers_free(&field->pending, gpu);
+    SDL_ReleaseGPUBuffer(gpu, field->steps.buffer);
+    SDL_ReleaseGPUBuffer(gpu, field->spans.buffer);
+    SDL_ReleaseGPUBuffer(gpu, field->bodies.buffer);
+    field->traced = (FieldLinesState) { .valid = false };
+    field->lines_residency.resident = false;
+    field->busy = false;
 }
 
-void field_update(
-    const Field *field,
-    const Simulation *sim,
-    SDL_GPUCommandBuffer *command_buffer,
-    SDL_GPUComputePass *compute_pass
-) {
-    if (!field->line_count || !field->options.enabled) return;
+void field_grid_update(Field *field, const FieldGridUpdateInfo *info) {
+    const SimulationFrame *sim = info->sim;
+    const Camera *cam = info->cam;
+    const bool enabled = field->options.enabled || info->potential;
+    if (GPUResidencyExpired(&field->grid_residency, enabled, RELEASE_DELAY)) field_grid_release(field, info->gpu);
+    if (!enabled) return;
+    if (!field->grid_residency.resident && field_grid_load(field, info->gpu) != SDL_APP_CONTINUE) {
+        field->options.enabled = false;
+        return;
+    }
+
+    // one cell per grid_resolution percent of a pixel, covering the viewport plus a margin to pan into
+    const f32 resolution = SDL_clamp(field->options.grid_resolution, 1.0f, 100.0f) / 100.0f;
+    const f32 cell_size = cam->zoom / resolution;
+    const HMM_Vec2 half_extent = HMM_MulV2F(cam->window_size, 0.5f * cam->zoom);
+    const HMM_Vec2 view_min = HMM_SubV2(cam->position, half_extent);
+    const HMM_Vec2 view_max = HMM_AddV2(cam->position, half_extent);
+
+    FieldGrid *grid = &field->grid;
+    const HMM_Vec2 grid_max = HMM_AddV2(grid->origin, HMM_V2(
+        (f32) (grid->size[0] - 1) * grid->cell_size,
+        (f32) (grid->size[1] - 1) * grid->cell_size
+    ));
+    const bool covered = view_min.X >= grid->origin.X && view_min.Y >= grid->origin.Y
+        && view_max.X <= grid_max.X && view_max.Y <= grid_max.Y;
+    const bool sharp = SDL_fabsf(grid->cell_size / cell_size - 1.0f) <= field->options.grid_threshold;
+    const bool rebuild = !grid->valid || !covered || !sharp
+        || grid->body_count != sim->body_count
+        || grid->gravity != sim->options.gravity
+        || grid->softening != sim->options.softening;
+    if (!rebuild && grid->sim_version == sim->version) return;
+
+    if (rebuild) {
+        const HMM_Vec2 margin = HMM_V2(FIELD_GRID_MARGIN * cell_size, FIELD_GRID_MARGIN * cell_size);
+        *grid = (FieldGrid) {
+            .cells = grid->cells,
+            .snapshot = grid->snapshot,
+            .state = grid->state,
+            .version = grid->version,
+            .origin = HMM_SubV2(view_min, margin),
+            .size = {
+                (u32) SDL_ceilf(2.0f * half_extent.X / cell_size) + 2 * FIELD_GRID_MARGIN + 1,
+                (u32) SDL_ceilf(2.0f * half_extent.Y / cell_size) + 2 * FIELD_GRID_MARGIN + 1
+            },
+            .cell_size = cell_size,
+            .body_count = sim->body_count,
+            .gravity = sim->options.gravity,
+            .softening = sim->options.softening,
+            .valid = true
+        };
+
+        ReserveGPUArray(&grid->cells, info->gpu, grid->size[0] * grid->size[1] * sizeof(HMM_Vec4));
+        ReserveGPUArray(&grid->snapshot, info->gpu, SDL_max(sim->body_count, 1) * sizeof(HMM_Vec2));
+    }
+    grid->sim_version = sim->version;
+    grid->version++;
+
+    const u32 cell_count = grid->size[0] * grid->size[1];
+    const u32 moved = 0;
+    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(info->command_buffer);
+    WriteToGPUBuffers(info->gpu, copy_pass, &(WriteGPUBufferBinding) {
+        .buffer = grid->state,
+        .source = (const u8*) &moved,
+        .size = sizeof(moved)
+    }, 1);
+    SDL_EndGPUCopyPass(copy_pass);
+
+    // without a rebuild, the grid is only refreshed once some body has moved further than the threshold since it was
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(info->command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = grid->cells.buffer, .cycle = false },
+        { .buffer = grid->snapshot.buffer, .cycle = false },
+        { .buffer = grid->state, .cycle = false },
+    }, 3);
+
+    struct {
+        u32 body_count;
+        f32 threshold;
+        u32 mode;
+        u32 force;
+    } moved_constants = {
+        sim->body_count,
+        field->options.grid_threshold * cell_size,
+        0,
+        rebuild
+    };
+
+    SDL_GPUBuffer *moved_buffers[] = { grid->snapshot.buffer, sim->positions.buffer, grid->state };
+    if (!rebuild && sim->body_count) {
+        SDL_PushGPUComputeUniformData(info->command_buffer, 0, &moved_constants, sizeof(moved_constants));
+        const u32 groups = kernel_bind(&field->moved_kernel, compute_pass, sim->body_count);
+        SDL_BindGPUComputeStorageBuffers(compute_pass, 0, moved_buffers, 3);
+        SDL_DispatchGPUCompute(compute_pass, groups, 1, 1);
+    }
+
     const struct {
+        HMM_Vec2 origin;
+        u32 size[2];
+        f32 cell_size;
         u32 body_count;
         f32 G;
         f32 ee;
-        f32 line_volume;
-        f32 line_step;
+        u32 force;
     } constants = {
+        grid->origin,
+        { grid->size[0], grid->size[1] },
+        grid->cell_size,
         sim->body_count,
         sim->options.gravity,
         sim->options.softening,
-        field->options.line_volume,
-        field->options.line_step,
+        rebuild
     };
 
+    // split across a second dimension once there are more workgroups than a single one allows
+    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &constants, sizeof(constants));
+    const u32 groups = kernel_bind(&field->grid_kernel, compute_pass, cell_count);
+    const u32 groups_x = SDL_min(groups, MAX_WORKGROUP_COUNT);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        grid->cells.buffer,
+        sim->positions.buffer,
+        sim->masses.buffer,
+        grid->state
+    }, 4);
+    SDL_DispatchGPUCompute(compute_pass, groups_x, (groups + groups_x - 1) / groups_x, 1);
+
+    if (sim->body_count) {
+        moved_constants.mode = 1;
+        SDL_PushGPUComputeUniformData(info->command_buffer, 0, &moved_constants, sizeof(moved_constants));
+        const u32 snapshot_groups = kernel_bind(&field->moved_kernel, compute_pass, sim->body_count);
+        SDL_BindGPUComputeStorageBuffers(compute_pass, 0, moved_buffers, 3);
+        SDL_DispatchGPUCompute(compute_pass, snapshot_groups, 1, 1);
+    }
+
+    SDL_EndGPUComputePass(compute_pass);
+}
+
+void field_add_body(Field *field, const bool selected) {
+    selection_add_body(&field->selection, selected);
+}
+
+// takes effect with the next set of lines, which the selection changing starts
+void field_select(Field *field, const u32 body, const bool selected) {
+    if (selected) selection_insert(&field->selection, body);
+    else selection_remove(&field->selection, body);
+}
+
+static bool field_options_equal(const FieldOptions *a, const FieldOptions *b) {
+    return a->line_budget == b->line_budget
+        && a->line_step == b->line_step
+        && a->grid_resolution == b->grid_resolution
+        && a->grid_threshold == b->grid_threshold
+        && a->enabled == b->enabled;
+}
+
+static void field_seed(Field *field, const FieldUpdateInfo *info, SDL_GPUCommandBuffer *command_buffer) {
+    const SimulationFrame *sim = info->sim;
+    const u32 line_count = field->tracing.line_count;
+    field_line_buffers_reserve(&field->pending, info->gpu, line_count);
+    ReserveGPUArray(&field->steps, info->gpu, line_count * sizeof(f32));
+    ReserveGPUArray(&field->spans, info->gpu, sim->body_count * 2 * sizeof(u32));
+
+    const u32 count = selection_count(&field->selection);
+    ReserveGPUArray(&field->bodies, info->gpu, count * sizeof(u32));
+    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+    WriteToGPUBuffers(info->gpu, copy_pass, &(WriteGPUBufferBinding) {
+        .buffer = field->bodies.buffer,
+        .source = (u8*) field->selection.bodies,
+        .size = count * sizeof(u32)
+    }, 1);
+    SDL_EndGPUCopyPass(copy_pass);
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = field->pending.line_ids.buffer, .cycle = false },
+        { .buffer = field->spans.buffer, .cycle = false },
+    }, 2);
+
+    const struct {
+        u32 body_count;
+        u32 line_budget;
+        u32 count;
+    } constants = { sim->body_count, line_count, count };
     SDL_PushGPUComputeUniformData(command_buffer, 0, &constants, sizeof(constants));
     SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
-        field->lines.buffer,
-        field->line_ids.buffer,
-        sim->positions_a.buffer,
-        sim->masses.buffer
+        sim->masses.buffer,
+        field->pending.line_ids.buffer,
+        field->spans.buffer,
+        field->bodies.buffer
+    }, 4);
+
+    // the prefix sum runs in one workgroup, sized to the bodies it has to walk through
+    kernel_bind(&field->seed_kernel, compute_pass, count);
+    SDL_DispatchGPUCompute(compute_pass, 1, 1, 1);
+    SDL_EndGPUComputePass(compute_pass);
+}
+
+void field_update(Field *field, const FieldUpdateInfo *info) {
+    const SimulationFrame *sim = info->sim;
+    if (GPUResidencyExpired(&field->lines_residency, field->options.enabled, RELEASE_DELAY)) field_lines_release(field, info->gpu);
+    if (!field->options.enabled || !field->grid.valid) return;
+    if (!field->lines_residency.resident && field_lines_load(field, info->gpu) != SDL_APP_CONTINUE) {
+        field->options.enabled = false;
+        return;
+    }
+
+    if (!sim->body_count || !selection_count(&field->selection)) {
+        field->traced.valid = false;
+        field->busy = false;
+        return;
+    }
+    if (field->options.line_budget <= 0) return;
+
+    // lines only depend on the grid, which is resampled whenever the simulation changes
+    const bool starting = !field->busy;
+    if (starting) {
+        const FieldLinesState tracing = {
+            .grid_version = field->grid.version,
+            .options = field->options,
+            .selection_version = field->selection.version,
+            .line_count = (u32) field->options.line_budget,
+            .body_count = sim->body_count,
+            .valid = true
+        };
+        if (field->traced.valid
+            && field->traced.grid_version == tracing.grid_version
+            && field->traced.body_count == tracing.body_count
+            && field->traced.selection_version == tracing.selection_version
+            && field_options_equal(&field->traced.options, &tracing.options)) return;
+        field->tracing = tracing;
+        field->progress = 0;
+        field->busy = true;
+    }
+
+    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(info->gpu);
+    if (starting) field_seed(field, info, command_buffer);
+
+    // later slices step through whatever grid is current, bodies added meanwhile wait for the next job
+    const FieldLinesState *job = &field->tracing;
+    const u32 steps = scheduler_plan_units(info->scheduler, SCHEDULER_WORK_FIELD, FIELD_LINE_LENGTH - field->progress);
+    const struct {
+        u32 body_count;
+        f32 G;
+        f32 ee;
+        f32 line_step;
+        HMM_Vec2 grid_origin;
+        u32 grid_size[2];
+        f32 grid_cell;
+        u32 line_count;
+    } constants = {
+        job->body_count,
+        sim->options.gravity,
+        sim->options.softening,
+        job->options.line_step,
+        field->grid.origin,
+        { field->grid.size[0], field->grid.size[1] },
+        field->grid.cell_size,
+        job->line_count,
+    };
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = field->pending.positions.buffer, .cycle = false },
+        { .buffer = field->pending.vertex_counts.buffer, .cycle = false },
+        { .buffer = field->pending.distances.buffer, .cycle = false },
+        { .buffer = field->steps.buffer, .cycle = false },
     }, 4);
 
-    SDL_BindGPUComputePipeline(compute_pass, field->pipeline);
-    for (u32 i = 0; i < FIELD_LINE_LENGTH; i++) {
+    SDL_PushGPUComputeUniformData(command_buffer, 0, &constants, sizeof(constants));
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        field->pending.positions.buffer,
+        field->pending.line_ids.buffer,
+        sim->positions.buffer,
+        sim->masses.buffer,
+        field->grid.cells.buffer,
+        field->pending.vertex_counts.buffer,
+        field->pending.distances.buffer,
+        field->steps.buffer,
+        field->spans.buffer
+    }, 9);
+
+    const u32 groups = kernel_bind(&field->kernel, compute_pass, job->line_count);
+    for (u32 i = field->progress; i < field->progress + steps; i++) {
         SDL_PushGPUComputeUniformData(command_buffer, 1, &i, sizeof(i));
-        SDL_DispatchGPUCompute(compute_pass, field->line_count, 1, 1);
+        SDL_DispatchGPUCompute(compute_pass, groups, 1, 1);
     }
+
+    SDL_EndGPUComputePass(compute_pass);
+    scheduler_submit(info->scheduler, info->gpu, command_buffer, SCHEDULER_WORK_FIELD, steps);
+
+    field->progress += steps;
+    if (field->progress < FIELD_LINE_LENGTH) return;
+    const FieldLineBuffers finished = field->pending;
+    field->pending = field->lines;
+    field->lines = finished;
+    field->traced = field->tracing;
+    field->busy = false;
 }
 
-void field_free(const Field *field, SDL_GPUDevice *gpu) {
-    SDL_ReleaseGPUBuffer(gpu, field->lines.buffer);
-    SDL_ReleaseGPUBuffer(gpu, field->line_ids.buffer);
-    SDL_ReleaseGPUComputePipeline(gpu, field->pipeline);
+void field_free(Field *field, SDL_GPUDevice *gpu) {
+    if (field->lines_residency.resident) field_lines_release(field, gpu);
+    if (field->grid_residency.resident) field_grid_release(field, gpu);
+    if (field->grid_residency.loaded) {
+        kernel_free(&field->grid_kernel, gpu);
+        kernel_free(&field->moved_kernel, gpu);
+    }
+    if (field->lines_residency.loaded) {
+        kernel_free(&field->seed_kernel, gpu);
+        kernel_free(&field->kernel, gpu);
+    }
+    selection_free(&field->selection);
 }
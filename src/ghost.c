@@ -1,47 +1,36 @@
 #include "ghost.h"
 #include "constants.h"
 #include "simulation.h"
-#include "trajectories.h"
-#include "field.h"
 #include "camera.h"
 
 #include "sdl_utils.h"
 
-void ghost_init(
-    Ghost *ghost,
-    Trajectories *trajectories,
-    SDL_GPUDevice *gpu,
-    SDL_GPUCopyPass *copy_pass
-) {
-    trajectories_add_body(trajectories, gpu, copy_pass);
+void ghost_init(Ghost *ghost) {
     *ghost = (Ghost) {
         .enabled = false,
         .mass = MASS_DEFAULT,
         .movable = true,
+        .trail = true,
+        .trajectory = true,
+        .field_lines = true,
         .color = COLOR_DEFAULT
     };
 }
 
-void ghost_update(Ghost *ghost, SDL_GPUDevice *gpu, const Simulation *sim, const Camera *cam) {
+void ghost_update(Ghost *ghost, SDL_GPUDevice *gpu, const SimulationFrame *sim, const Camera *cam) {
     if (!ghost->enabled) return;
 
     HMM_Vec2 target_position = HMM_V2(0.0f, 0.0f);
     HMM_Vec2 target_velocity = HMM_V2(0.0f, 0.0f);
-    if (cam->target != (u32) -1) {
-        ReadFromGPUBufferNow(gpu, (ReadGPUBufferBinding[]) {
-            {
-                .buffer = sim->positions_a.buffer,
-                .buffer_offset = cam->target * sizeof(HMM_Vec2),
-                .destination = (u8*) &target_position,
-                .size = sizeof(HMM_Vec2)
-            },
-            {
-                .buffer = sim->velocities.buffer,
-                .buffer_offset = cam->target * sizeof(HMM_Vec2),
-                .destination = (u8*) &target_velocity,
-                .size = sizeof(HMM_Vec2)
-            },
-        }, 2);
+    if (cam->target < sim->body_count) {
+        // the camera already follows the target's interpolated position
+        target_position = cam->position;
+        ReadFromGPUBufferNow(gpu, &(ReadGPUBufferBinding) {
+            .buffer = sim->velocities.buffer,
+            .buffer_offset = cam->target * sizeof(HMM_Vec2),
+            .destination = (u8*) &target_velocity,
+            .size = sizeof(HMM_Vec2)
+        }, 1);
     }
 
     const HMM_Vec2 mouse = mouse_world_position(cam);
@@ -1,11 +1,13 @@
 #include "graphics.h"
 #include "constants.h"
 #include "sdl_utils.h"
+#include "shader_cache.h"
 #include "simulation.h"
 #include "ghost.h"
 #include "trails.h"
 #include "trajectories.h"
 #include "field.h"
+#include "tracers.h"
 #include "camera.h"
 
 #include "SDL3/SDL_gpu.h"
@@ -15,57 +17,105 @@
 #define TRAIL_SIZE sizeof(HMM_Vec2) * TRAIL_LENGTH
 #define PREDICTION_SIZE sizeof(HMM_Vec2) * PREDICTIONS_LENGTH
 
+typedef struct {
+    SDL_GPUDevice *gpu;
+    SDL_GPUGraphicsPipeline **pipeline;
+    CreateGPUGraphicsPipelineInfo info;
+} GraphicsPipelineJob;
+
+static void graphics_pipeline_job(void *data, const u32 index) {
+    GraphicsPipelineJob *job = &((GraphicsPipelineJob*) data)[index];
+    *job->pipeline = CreateGPUGraphicsPipeline(job->gpu, &job->info);
+}
+
 SDL_AppResult graphics_init(Graphics *gfx, SDL_GPUDevice *gpu, SDL_Window *window) {
     gfx->options = (GraphicsOptions) {
         .clear_color = CLEAR_COLOR_DEFAULT,
         .movable_outline = MOVABLE_OUTLINE_DEFAULT,
         .static_outline = STATIC_OUTLINE_DEFAULT,
         .trail_brightness = TRAIL_FADE_DEFAULT,
-        .trails = true,
-        .potential = false
+        .splat_threshold = SPLAT_THRESHOLD_DEFAULT,
+        .splat_exposure = SPLAT_EXPOSURE_DEFAULT,
+        .tracer_color = TRACER_COLOR_DEFAULT,
+        .tracer_exposure = TRACER_EXPOSURE_DEFAULT,
+        .lod_error = LOD_ERROR_DEFAULT,
+        .contour_color = CONTOUR_COLOR_DEFAULT,
+        .contour_base = CONTOUR_BASE_DEFAULT,
+        .contour_ratio = CONTOUR_RATIO_DEFAULT,
+        .contour_levels = CONTOUR_LEVELS_DEFAULT,
+        .potential = false,
+        .equipotentials = false
     };
 
-    gfx->body_pipeline = CreateGPUGraphicsPipeline(gpu, &(CreateGPUGraphicsPipelineInfo) {
-        .window = window,
-        .vertex_shader_path = "shaders/graphics/body.vert.spv",
-        .fragment_shader_path = "shaders/graphics/circle.frag.spv",
-        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP,
-    });
-
-    gfx->trail_pipeline = CreateGPUGraphicsPipeline(gpu, &(CreateGPUGraphicsPipelineInfo) {
-        .window = window,
-        .vertex_shader_path = "shaders/graphics/trail.vert.spv",
-        .fragment_shader_path = "shaders/graphics/solid.frag.spv",
-        .primitive_type = SDL_GPU_PRIMITIVETYPE_LINESTRIP
-    });
-
-    gfx->trajectory_pipeline = CreateGPUGraphicsPipeline(gpu, &(CreateGPUGraphicsPipelineInfo) {
-        .window = window,
-        .vertex_shader_path = "shaders/graphics/trajectory.vert.spv",
-        .fragment_shader_path = "shaders/graphics/solid.frag.spv",
-        .primitive_type = SDL_GPU_PRIMITIVETYPE_LINESTRIP
-    });
-
-    gfx->ghost_body_pipeline = CreateGPUGraphicsPipeline(gpu, &(CreateGPUGraphicsPipelineInfo) {
-        .window = window,
-        .vertex_shader_path = "shaders/graphics/ghost_body.vert.spv",
-        .fragment_shader_path = "shaders/graphics/circle.frag.spv",
-        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP
-    });
-
-    gfx->field_pipeline = CreateGPUGraphicsPipeline(gpu, &(CreateGPUGraphicsPipelineInfo) {
-        .window = window,
-        .vertex_shader_path = "shaders/graphics/field.vert.spv",
-        .fragment_shader_path = "shaders/graphics/solid.frag.spv",
-        .primitive_type = SDL_GPU_PRIMITIVETYPE_LINESTRIP
-    });
+    enum { BODY_VERT, GHOST_BODY_VERT, TRAIL_VERT, TRAJECTORY_VERT, FIELD_VERT, SCREEN_VERT, CONTOUR_VERT, CIRCLE_FRAG, SOLID_FRAG, POTENTIAL_FRAG, SPLAT_FRAG, SHADER_COUNT };
+    ShaderCacheLoad shaders[SHADER_COUNT] = {
+        [BODY_VERT] = { .path = "shaders/graphics/body.vert.spv" },
+        [GHOST_BODY_VERT] = { .path = "shaders/graphics/ghost_body.vert.spv" },
+        [TRAIL_VERT] = { .path = "shaders/graphics/trail.vert.spv" },
+        [TRAJECTORY_VERT] = { .path = "shaders/graphics/trajectory.vert.spv" },
+        [FIELD_VERT] = { .path = "shaders/graphics/field.vert.spv" },
+        [SCREEN_VERT] = { .path = "shaders/graphics/screen.vert.spv" },
+        [CONTOUR_VERT] = { .path = "shaders/graphics/contour.vert.spv" },
+        [CIRCLE_FRAG] = { .path = "shaders/graphics/circle.frag.spv" },
+        [SOLID_FRAG] = { .path = "shaders/graphics/solid.frag.spv" },
+        [POTENTIAL_FRAG] = { .path = "shaders/graphics/potential.frag.spv" },
+        [SPLAT_FRAG] = { .path = "shaders/graphics/splat.frag.spv" },
+    };
+    if (!shader_cache_load(gpu, shaders, SHADER_COUNT)) panic("Failed to load graphics shaders!");
+
+    GraphicsPipelineJob pipelines[] = {
+        { gpu, &gfx->body_pipeline, {
+            .window = window,
+            .vertex_shader = shaders[BODY_VERT].shader,
+            .fragment_shader = shaders[CIRCLE_FRAG].shader,
+            .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP
+        } },
+        { gpu, &gfx->trail_pipeline, {
+            .window = window,
+            .vertex_shader = shaders[TRAIL_VERT].shader,
+            .fragment_shader = shaders[SOLID_FRAG].shader,
+            .primitive_type = SDL_GPU_PRIMITIVETYPE_LINELIST
+        } },
+        { gpu, &gfx->trajectory_pipeline, {
+            .window = window,
+            .vertex_shader = shaders[TRAJECTORY_VERT].shader,
+            .fragment_shader = shaders[SOLID_FRAG].shader,
+            .primitive_type = SDL_GPU_PRIMITIVETYPE_LINELIST
+        } },
+        { gpu, &gfx->ghost_body_pipeline, {
+            .window = window,
+            .vertex_shader = shaders[GHOST_BODY_VERT].shader,
+            .fragment_shader = shaders[CIRCLE_FRAG].shader,
+            .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP
+        } },
+        { gpu, &gfx->field_pipeline, {
+            .window = window,
+            .vertex_shader = shaders[FIELD_VERT].shader,
+            .fragment_shader = shaders[SOLID_FRAG].shader,
+            .primitive_type = SDL_GPU_PRIMITIVETYPE_LINELIST
+        } },
+        { gpu, &gfx->potential_pipeline, {
+            .window = window,
+            .vertex_shader = shaders[SCREEN_VERT].shader,
+            .fragment_shader = shaders[POTENTIAL_FRAG].shader,
+            .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP
+        } },
+        { gpu, &gfx->splat_pipeline, {
+            .window = window,
+            .vertex_shader = shaders[SCREEN_VERT].shader,
+            .fragment_shader = shaders[SPLAT_FRAG].shader,
+            .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP
+        } },
+        { gpu, &gfx->contour_pipeline, {
+            .window = window,
+            .vertex_shader = shaders[CONTOUR_VERT].shader,
+            .fragment_shader = shaders[SOLID_FRAG].shader,
+            .primitive_type = SDL_GPU_PRIMITIVETYPE_LINELIST
+        } },
+    };
 
-    gfx->potential_pipeline = CreateGPUGraphicsPipeline(gpu, &(CreateGPUGraphicsPipelineInfo) {
-        .window = window,
-        .vertex_shader_path = "shaders/graphics/screen.vert.spv",
-        .fragment_shader_path = "shaders/graphics/potential.frag.spv",
-        .primitive_type = SDL_GPU_PRIMITIVETYPE_TRIANGLESTRIP
-    });
+    shader_cache_parallel(graphics_pipeline_job, pipelines, SDL_arraysize(pipelines));
+    for (u32 i = 0; i < SHADER_COUNT; i++) SDL_ReleaseGPUShader(gpu, shaders[i].shader);
 
     if (!gfx->body_pipeline) panic("Failed to create circle graphics pipeline!");
     if (!gfx->trail_pipeline) panic("Failed to create trail graphics pipeline!");
@@ -73,45 +123,106 @@ SDL_AppResult graphics_init(Graphics *gfx, SDL_GPUDevice *gpu, SDL_Window *windo
     if (!gfx->ghost_body_pipeline) panic("Failed to create ghost body graphics pipeline!");
     if (!gfx->field_pipeline) panic("Failed to create field lines graphics pipeline!");
     if (!gfx->potential_pipeline) panic("Failed to create potential graphics pipeline!");
-
-    gfx->colors = CreateGPUArray(gpu, sizeof(SDL_FColor), SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ);
+    if (!gfx->splat_pipeline) panic("Failed to create splat graphics pipeline!");
+    if (!gfx->contour_pipeline) panic("Failed to create contour graphics pipeline!");
+    if (!kernel_init(&gfx->splat_clear_kernel, gpu, "shaders/splat_clear.comp")) panic("Failed to create splat clear compute pipeline!");
+    if (!kernel_init(&gfx->splat_kernel, gpu, "shaders/splat.comp")) panic("Failed to create splat compute pipeline!");
+    if (!kernel_init(&gfx->splat_tracers_kernel, gpu, "shaders/splat_tracers.comp")) panic("Failed to create tracer splat compute pipeline!");
+    if (!kernel_init(&gfx->cull_bodies_kernel, gpu, "shaders/cull_bodies.comp")) panic("Failed to create body culling compute pipeline!");
+    if (!kernel_init(&gfx->lod_lines_kernel, gpu, "shaders/lod_lines.comp")) panic("Failed to create line LOD compute pipeline!");
+    if (!kernel_init(&gfx->contour_kernel, gpu, "shaders/contours.comp")) panic("Failed to create contour compute pipeline!");
+
+    gfx->colors = CreateGPUArray(gpu, sizeof(SDL_FColor), SDL_GPU_BUFFERUSAGE_READDRAW);
+    gfx->splat = CreateGPUArray(gpu, 4 * sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    gfx->tracer_splat = CreateGPUArray(gpu, 4 * sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
     if (!gfx->colors.buffer) panic("Failed to create color storage buffer!");
+    if (!gfx->splat.buffer) panic("Failed to create splat storage buffer!");
+    if (!gfx->tracer_splat.buffer) panic("Failed to create tracer splat storage buffer!");
+    for (u32 i = 0; i < GRAPHICS_CULL_COUNT; i++) {
+        gfx->visible[i] = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+        if (!gfx->visible[i].buffer) panic("Failed to create visible instances storage buffer!");
+    }
+
+    gfx->draw_arguments = SDL_CreateGPUBuffer(gpu, &(SDL_GPUBufferCreateInfo) {
+        .usage = SDL_GPU_BUFFERUSAGE_INDIRECT | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+        .size = GRAPHICS_CULL_COUNT * sizeof(SDL_GPUIndirectDrawCommand)
+    });
+    if (!gfx->draw_arguments) panic("Failed to create indirect draw arguments buffer!");
+    gfx->line_demand = SDL_CreateGPUBuffer(gpu, &(SDL_GPUBufferCreateInfo) {
+        .usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+        .size = GRAPHICS_CULL_COUNT * sizeof(u32)
+    });
+    if (!gfx->line_demand) panic("Failed to create line demand buffer!");
+    for (u32 i = 0; i < LOD_READBACK_FRAMES; i++) {
+        gfx->demand_readbacks[i] = SDL_CreateGPUTransferBuffer(gpu, &(SDL_GPUTransferBufferCreateInfo) {
+            .usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD,
+            .size = GRAPHICS_CULL_COUNT * sizeof(u32)
+        });
+        if (!gfx->demand_readbacks[i]) panic("Failed to create line demand readback buffer!");
+        gfx->demand_pending[i] = false;
+    }
+    gfx->demand_frame = 0;
+    for (u32 i = 0; i < GRAPHICS_CULL_COUNT; i++) gfx->line_demands[i] = 0;
+
+    gfx->contours = CreateGPUArray(gpu, 2 * sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    gfx->contour_arguments = SDL_CreateGPUBuffer(gpu, &(SDL_GPUBufferCreateInfo) {
+        .usage = SDL_GPU_BUFFERUSAGE_INDIRECT | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+        .size = sizeof(SDL_GPUIndirectDrawCommand)
+    });
+    if (!gfx->contours.buffer) panic("Failed to create contour storage buffer!");
+    if (!gfx->contour_arguments) panic("Failed to create contour draw arguments buffer!");
+    gfx->contoured = (GraphicsContourState) { .valid = false };
+    gfx->max_mass = 0.0f;
     return SDL_APP_CONTINUE;
 }
 
-void graphics_add_body(Graphics *gfx, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass, SDL_FColor *color) {
-    AppendGPUArrays(gpu, copy_pass, &(AppendGPUArrayBinding) {
+void graphics_add_body(Graphics *gfx, const GraphicsAddBodyInfo *info) {
+    AppendGPUArrays(info->gpu, info->copy_pass, &(AppendGPUArrayBinding) {
         .array = &gfx->colors,
-        .source = (u8*) color,
+        .source = (const u8*) info->color,
         .size = sizeof(SDL_FColor)
     }, 1);
+    gfx->max_mass = SDL_max(gfx->max_mass, info->mass);
 }
 
 static void graphics_uniform_camera(SDL_GPUCommandBuffer *command_buffer, const Camera *cam, u32 slot);
 typedef struct {
     SDL_GPUCommandBuffer *command_buffer;
-    const Simulation *sim;
+    const SimulationFrame *sim;
     const Trails *trails;
     const Camera *cam;
+    const f32 alpha;
     const u32 slot;
 } GraphicsUniformConsantsInfo;
 static void graphics_uniform_constants(const Graphics *gfx, const GraphicsUniformConsantsInfo *info);
 static void graphics_uniform_ghost(SDL_GPUCommandBuffer *command_buffer, const Ghost *ghost, u32 slot);
 
-static void graphics_simulation_draw(const Graphics *gfx, const Simulation *sim, SDL_GPURenderPass *render_pass);
+static bool graphics_splat_active(const Graphics *gfx, const SimulationFrame *sim, const Camera *cam);
+static void graphics_splat_clear(const Graphics *gfx, const GraphicsDrawInfo *info, GPUArray *splat, u32 width, u32 height);
+static void graphics_splat(Graphics *gfx, const GraphicsDrawInfo *info, u32 width, u32 height);
+static void graphics_splat_tracers(Graphics *gfx, const GraphicsDrawInfo *info, u32 width, u32 height);
+static void graphics_cull(Graphics *gfx, const GraphicsDrawInfo *info);
+static void graphics_contours(Graphics *gfx, const GraphicsDrawInfo *info);
+static void graphics_simulation_draw(const Graphics *gfx, const SimulationFrame *sim, SDL_GPURenderPass *render_pass);
+static void graphics_splat_draw(const Graphics *gfx, SDL_GPURenderPass *render_pass, SDL_GPUCommandBuffer *command_buffer, const GPUArray *splat, u32 width, f32 exposure);
 static void graphics_ghost_draw(const Graphics *gfx, const Ghost *ghost, SDL_GPURenderPass *render_pass);
-static void graphics_trails_draw(const Graphics *gfx, const Trails *trails, const Simulation *sim, SDL_GPURenderPass *render_pass);
-static void graphics_trajectories_draw(const Graphics *gfx, const Trajectories *trajectories, const Simulation *sim, const Ghost *ghost, SDL_GPURenderPass *render_pass);
-static void graphics_field_draw(const Graphics *gfx, const Field *field, SDL_GPURenderPass *render_pass);
-static void graphics_potential_draw(const Graphics *gfx, const Simulation *sim, SDL_GPURenderPass *render_pass, SDL_GPUCommandBuffer *command_buffer);
+static void graphics_trails_draw(const Graphics *gfx, const Trails *trails, const SimulationFrame *sim, const Camera *cam, SDL_GPURenderPass *render_pass, SDL_GPUCommandBuffer *command_buffer);
+static void graphics_trajectories_draw(const Graphics *gfx, const Trajectories *trajectories, const SimulationFrame *sim, const Camera *cam, SDL_GPURenderPass *render_pass, SDL_GPUCommandBuffer *command_buffer);
+static void graphics_field_draw(const Graphics *gfx, const Field *field, SDL_GPURenderPass *render_pass, SDL_GPUCommandBuffer *command_buffer);
+static void graphics_potential_draw(const Graphics *gfx, const SimulationFrame *sim, const Field *field, SDL_GPURenderPass *render_pass, SDL_GPUCommandBuffer *command_buffer);
+static void graphics_contours_draw(const Graphics *gfx, SDL_GPURenderPass *render_pass, SDL_GPUCommandBuffer *command_buffer);
 static void graphics_gui_draw(SDL_GPUCommandBuffer *command_buffer, SDL_GPUTexture *swapchain);
-void graphics_draw(const Graphics *gfx, const GraphicsDrawInfo *info) {
+void graphics_draw(Graphics *gfx, const GraphicsDrawInfo *info) {
     SDL_GPUTexture *swapchain;
-    SDL_WaitAndAcquireGPUSwapchainTexture(info->command_buffer, info->window, &swapchain, NULL, NULL);
-    if (!swapchain) {
-        SDL_SubmitGPUCommandBuffer(info->command_buffer);
-        return;
-    }
+    u32 width, height;
+    SDL_WaitAndAcquireGPUSwapchainTexture(info->command_buffer, info->window, &swapchain, &width, &height);
+    if (!swapchain) return;
+
+    gfx->splatting = graphics_splat_active(gfx, info->sim, info->cam);
+    if (gfx->splatting) graphics_splat(gfx, info, width, height);
+    if (info->tracers->options.enabled && info->tracers->seeded) graphics_splat_tracers(gfx, info, width, height);
+    graphics_cull(gfx, info);
+    graphics_contours(gfx, info);
 
     graphics_uniform_camera(info->command_buffer, info->cam, 0);
     graphics_uniform_constants(gfx, &(GraphicsUniformConsantsInfo) {
@@ -119,6 +230,7 @@ void graphics_draw(const Graphics *gfx, const GraphicsDrawInfo *info) {
         .sim = info->sim,
         .trails = info->trails,
         .cam = info->cam,
+        .alpha = info->alpha,
         .slot = 1
     });
     graphics_uniform_ghost(info->command_buffer, info->ghost, 2);
@@ -130,12 +242,16 @@ void graphics_draw(const Graphics *gfx, const GraphicsDrawInfo *info) {
         .texture = swapchain
     }, 1, NULL);
 
-    graphics_potential_draw(gfx, info->sim, render_pass, info->command_buffer);
-    graphics_simulation_draw(gfx, info->sim, render_pass);
+    graphics_potential_draw(gfx, info->sim, info->field, render_pass, info->command_buffer);
+    graphics_contours_draw(gfx, render_pass, info->command_buffer);
+    if (info->tracers->options.enabled && info->tracers->seeded)
+        graphics_splat_draw(gfx, render_pass, info->command_buffer, &gfx->tracer_splat, width, gfx->options.tracer_exposure);
+    if (gfx->splatting) graphics_splat_draw(gfx, render_pass, info->command_buffer, &gfx->splat, width, gfx->options.splat_exposure);
+    else graphics_simulation_draw(gfx, info->sim, render_pass);
     graphics_ghost_draw(gfx, info->ghost, render_pass);
-    graphics_trails_draw(gfx, info->trails, info->sim, render_pass);
-    graphics_trajectories_draw(gfx, info->trajectories, info->sim, info->ghost, render_pass);
-    graphics_field_draw(gfx, info->field, render_pass);
+    graphics_trails_draw(gfx, info->trails, info->sim, info->cam, render_pass, info->command_buffer);
+    graphics_trajectories_draw(gfx, info->trajectories, info->sim, info->cam, render_pass, info->command_buffer);
+    graphics_field_draw(gfx, info->field, render_pass, info->command_buffer);
     SDL_EndGPURenderPass(render_pass);
 
     graphics_gui_draw(info->command_buffer, swapchain);
@@ -156,6 +272,7 @@ static void graphics_uniform_constants(const Graphics *gfx, const GraphicsUnifor
         f32 trail_brightness;
         u32 body_count;
         u32 trail_frame;
+        f32 alpha;
     } constants = {
         info->sim->options.density,
         gfx->options.movable_outline,
@@ -164,6 +281,7 @@ static void graphics_uniform_constants(const Graphics *gfx, const GraphicsUnifor
         gfx->options.trail_brightness,
         info->sim->body_count,
         info->trails->frame,
+        info->alpha,
     };
 
     SDL_PushGPUVertexUniformData(info->command_buffer, info->slot, &constants, sizeof(constants));
@@ -185,16 +303,422 @@ static void graphics_uniform_ghost(SDL_GPUCommandBuffer *command_buffer, const G
     SDL_PushGPUVertexUniformData(command_buffer, slot, &ghost_info, sizeof(ghost_info));
 }
 
-static void graphics_simulation_draw(const Graphics *gfx, const Simulation *sim, SDL_GPURenderPass *render_pass) {
+static void graphics_simulation_draw(const Graphics *gfx, const SimulationFrame *sim, SDL_GPURenderPass *render_pass) {
     if (!sim->body_count) return;
     SDL_BindGPUGraphicsPipeline(render_pass, gfx->body_pipeline);
     SDL_BindGPUVertexStorageBuffers(render_pass, 0, (SDL_GPUBuffer*[]) {
-        sim->positions_a.buffer,
+        sim->positions.buffer,
         gfx->colors.buffer,
         sim->masses.buffer,
-        sim->movable.buffer
-    }, 4);
-    SDL_DrawGPUPrimitives( render_pass, 4, sim->body_count, 0, 0);
+        sim->movable.buffer,
+        sim->previous_positions.buffer,
+        gfx->visible[GRAPHICS_CULL_BODIES].buffer
+    }, 6);
+    SDL_DrawGPUPrimitivesIndirect(render_pass, gfx->draw_arguments, GRAPHICS_CULL_BODIES * sizeof(SDL_GPUIndirectDrawCommand), 1);
+}
+
+static bool graphics_splat_active(const Graphics *gfx, const SimulationFrame *sim, const Camera *cam) {
+    // once even the largest body covers less than the threshold in pixels, drawing quads adds nothing visible
+    if (!sim->body_count || gfx->options.splat_threshold <= 0.0f) return false;
+    const f32 diameter = 2.0f * SDL_powf(gfx->max_mass / sim->options.density, 1.0f / 3.0f);
+    return diameter / cam->zoom < gfx->options.splat_threshold;
+}
+
+static void graphics_splat_clear(const Graphics *gfx, const GraphicsDrawInfo *info, GPUArray *splat, const u32 width, const u32 height) {
+    const u32 count = 4 * width * height;
+    ReserveGPUArray(splat, info->gpu, count * sizeof(u32));
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(info->command_buffer, NULL, 0, &(SDL_GPUStorageBufferReadWriteBinding) {
+        .buffer = splat->buffer,
+        .cycle = true
+    }, 1);
+    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &count, sizeof(count));
+    const u32 groups = kernel_bind(&gfx->splat_clear_kernel, compute_pass, count);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, &splat->buffer, 1);
+    SDL_DispatchGPUCompute(compute_pass, SDL_min(groups, MAX_WORKGROUP_COUNT), 1, 1);
+    SDL_EndGPUComputePass(compute_pass);
+}
+
+static void graphics_splat(Graphics *gfx, const GraphicsDrawInfo *info, const u32 width, const u32 height) {
+    graphics_splat_clear(gfx, info, &gfx->splat, width, height);
+
+    const struct {
+        HMM_Mat4 orthographic;
+        HMM_Mat4 view;
+        u32 size[2];
+        f32 alpha;
+        u32 body_count;
+    } constants = {
+        info->cam->orthographic,
+        info->cam->view,
+        { width, height },
+        info->alpha,
+        info->sim->body_count
+    };
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(info->command_buffer, NULL, 0, &(SDL_GPUStorageBufferReadWriteBinding) {
+        .buffer = gfx->splat.buffer,
+        .cycle = false
+    }, 1);
+    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &constants, sizeof(constants));
+    const u32 groups = kernel_bind(&gfx->splat_kernel, compute_pass, info->sim->body_count);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        gfx->splat.buffer,
+        info->sim->positions.buffer,
+        info->sim->previous_positions.buffer,
+        info->sim->masses.buffer,
+        gfx->colors.buffer
+    }, 5);
+    SDL_DispatchGPUCompute(compute_pass, groups, 1, 1);
+    SDL_EndGPUComputePass(compute_pass);
+}
+
+// tracers share the body splat's format, so each one counts as a unit of mass in the tracer color
+static void graphics_splat_tracers(Graphics *gfx, const GraphicsDrawInfo *info, const u32 width, const u32 height) {
+    const Tracers *tracers = info->tracers;
+    graphics_splat_clear(gfx, info, &gfx->tracer_splat, width, height);
+
+    const struct {
+        HMM_Mat4 orthographic;
+        HMM_Mat4 view;
+        SDL_FColor color;
+        u32 size[2];
+        u32 tracer_count;
+    } constants = {
+        info->cam->orthographic,
+        info->cam->view,
+        gfx->options.tracer_color,
+        { width, height },
+        tracers->count
+    };
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(info->command_buffer, NULL, 0, &(SDL_GPUStorageBufferReadWriteBinding) {
+        .buffer = gfx->tracer_splat.buffer,
+        .cycle = false
+    }, 1);
+    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &constants, sizeof(constants));
+    const u32 groups = kernel_bind(&gfx->splat_tracers_kernel, compute_pass, tracers->count);
+    const u32 groups_x = SDL_min(groups, MAX_WORKGROUP_COUNT);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        gfx->tracer_splat.buffer,
+        tracers->positions.buffer
+    }, 2);
+    SDL_DispatchGPUCompute(compute_pass, groups_x, (groups + groups_x - 1) / groups_x, 1);
+    SDL_EndGPUComputePass(compute_pass);
+}
+
+typedef struct {
+    GraphicsCull cull;
+    SDL_GPUBuffer *lines;
+    u32 line_count;
+    u32 line_length;
+    u32 target;
+    u32 anchor;
+    bool ring;
+    SDL_GPUBuffer *vertex_counts; // optional, per line vertex counts for lines that end early
+    SDL_GPUBuffer *times; // optional, per vertex times for lines whose vertices are spaced unevenly
+    SDL_GPUBuffer *anchors; // optional, per line trail anchors for lines stored as packed offsets
+    SDL_GPUBuffer *slots; // optional, the lines to cull when only some of them are drawn, line_count of them
+} GraphicsLodLinesInfo;
+
+static void graphics_lod_lines(const Graphics *gfx, const GraphicsDrawInfo *info, SDL_GPUComputePass *compute_pass, const GraphicsLodLinesInfo *lines) {
+    const HMM_Vec2 half_size = HMM_MulV2F(info->cam->window_size, 0.5f * info->cam->zoom * (1.0f + GRAPHICS_CULL_MARGIN));
+    const struct {
+        HMM_Vec2 view_min;
+        HMM_Vec2 view_max;
+        u32 line_count;
+        u32 line_length;
+        u32 target;
+        u32 anchor;
+        u32 ring;
+        f32 tolerance;
+        u32 argument_offset;
+        u32 variable;
+        u32 timed;
+        u32 quantized;
+        u32 capacity;
+        u32 slotted;
+    } constants = {
+        HMM_SubV2(info->cam->position, half_size),
+        HMM_AddV2(info->cam->position, half_size),
+        lines->line_count,
+        lines->line_length,
+        lines->target,
+        lines->anchor,
+        lines->ring,
+        gfx->options.lod_error * info->cam->zoom,
+        lines->cull * 4,
+        lines->vertex_counts != NULL,
+        lines->times != NULL,
+        lines->anchors != NULL,
+        gfx->visible[lines->cull].info.size / (u32) sizeof(u32),
+        lines->slots != NULL
+    };
+
+    // a workgroup per line, as wide as the line can keep busy
+    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &constants, sizeof(constants));
+    kernel_bind(&gfx->lod_lines_kernel, compute_pass, lines->line_length);
+    const u32 groups_x = SDL_min(lines->line_count, MAX_WORKGROUP_COUNT);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        lines->lines,
+        gfx->visible[lines->cull].buffer,
+        gfx->draw_arguments,
+        lines->vertex_counts ? lines->vertex_counts : lines->lines, // never read unless variable
+        lines->times ? lines->times : lines->lines, // never read unless timed
+        lines->lines, // packed offsets are read through here when quantized
+        lines->anchors ? lines->anchors : lines->lines, // never read unless quantized
+        gfx->line_demand,
+        lines->slots ? lines->slots : lines->lines // never read unless slotted
+    }, 9);
+    SDL_DispatchGPUCompute(compute_pass, groups_x, (lines->line_count + groups_x - 1) / groups_x, 1);
+}
+
+// the newest segment counts the GPU has finished writing, a few frames old. anything that retired at once is read
+// together and only the newest kept
+static void graphics_lod_readback(Graphics *gfx, const GraphicsDrawInfo *info) {
+    for (u32 i = 0; i < LOD_READBACK_FRAMES; i++) {
+        if (!gfx->demand_pending[i] || (i32) (info->frames_retired - gfx->demand_frames[i]) < 0) continue;
+        gfx->demand_pending[i] = false;
+        if ((i32) (gfx->demand_frames[i] - gfx->demand_frame) <= 0) continue;
+
+        const u32 *demand = SDL_MapGPUTransferBuffer(info->gpu, gfx->demand_readbacks[i], false);
+        if (!demand) continue;
+        SDL_memcpy(gfx->line_demands, demand, sizeof(gfx->line_demands));
+        SDL_UnmapGPUTransferBuffer(info->gpu, gfx->demand_readbacks[i]);
+        gfx->demand_frame = gfx->demand_frames[i];
+    }
+}
+
+// a readback slot is only reused once the frame that filled it has been read, frames that find theirs busy skip it
+static void graphics_lod_download(Graphics *gfx, const GraphicsDrawInfo *info) {
+    const u32 slot = info->frame % LOD_READBACK_FRAMES;
+    if (gfx->demand_pending[slot]) return;
+
+    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(info->command_buffer);
+    SDL_DownloadFromGPUBuffer(copy_pass, &(SDL_GPUBufferRegion) {
+        .buffer = gfx->line_demand,
+        .offset = 0,
+        .size = GRAPHICS_CULL_COUNT * sizeof(u32)
+    }, &(SDL_GPUTransferBufferLocation) {
+        .transfer_buffer = gfx->demand_readbacks[slot],
+        .offset = 0
+    });
+    SDL_EndGPUCopyPass(copy_pass);
+    gfx->demand_frames[slot] = info->frame;
+    gfx->demand_pending[slot] = true;
+}
+
+static void graphics_cull(Graphics *gfx, const GraphicsDrawInfo *info) {
+    // every draw starts out empty, the kernels append visible bodies as instances and decimated lines as segments
+    const SimulationFrame *sim = info->sim;
+    const u32 trail_count = info->trails->residency.resident ? selection_count(&info->trails->selection) : 0;
+    const u32 trajectory_count = trajectories_count(info->trajectories);
+    const u32 field_line_count = info->field->traced.valid ? info->field->traced.line_count : 0;
+    const u32 counts[GRAPHICS_CULL_COUNT] = {
+        sim->body_count,
+        2 * TRAIL_LENGTH * trail_count,
+        2 * PREDICTION_LENGTH * trajectory_count,
+        2 * FIELD_LINE_LENGTH * field_line_count
+    };
+    const SDL_GPUIndirectDrawCommand arguments[GRAPHICS_CULL_COUNT] = {
+        [GRAPHICS_CULL_BODIES] = { .num_vertices = 4 },
+        [GRAPHICS_CULL_TRAILS] = { .num_instances = 1 },
+        [GRAPHICS_CULL_TRAJECTORIES] = { .num_instances = 1 },
+        [GRAPHICS_CULL_FIELD] = { .num_instances = 1 },
+    };
+
+    // every body can be visible at once, but lines are sized by what they asked for with some room to grow.
+    // lines that don't fit are left out for the few frames it takes their demand to be read back
+    graphics_lod_readback(gfx, info);
+    ReserveGPUArray(&gfx->visible[GRAPHICS_CULL_BODIES], info->gpu, SDL_max(counts[GRAPHICS_CULL_BODIES], 1) * sizeof(u32));
+    for (u32 i = GRAPHICS_CULL_TRAILS; i < GRAPHICS_CULL_COUNT; i++) {
+        const u32 demand = gfx->line_demands[i] + gfx->line_demands[i] / 2 + LOD_SEGMENTS_MIN;
+        ReserveGPUArray(&gfx->visible[i], info->gpu, SDL_max(SDL_min(counts[i], demand), 1) * sizeof(u32));
+    }
+
+    const u32 no_demand[GRAPHICS_CULL_COUNT] = { 0 };
+    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(info->command_buffer);
+    WriteToGPUBuffers(info->gpu, copy_pass, (WriteGPUBufferBinding[]) {
+        { .buffer = gfx->draw_arguments, .source = (const u8*) arguments, .size = sizeof(arguments) },
+        { .buffer = gfx->line_demand, .source = (const u8*) no_demand, .size = sizeof(no_demand) }
+    }, 2);
+    SDL_EndGPUCopyPass(copy_pass);
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(info->command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = gfx->visible[GRAPHICS_CULL_BODIES].buffer, .cycle = true },
+        { .buffer = gfx->visible[GRAPHICS_CULL_TRAILS].buffer, .cycle = true },
+        { .buffer = gfx->visible[GRAPHICS_CULL_TRAJECTORIES].buffer, .cycle = true },
+        { .buffer = gfx->visible[GRAPHICS_CULL_FIELD].buffer, .cycle = true },
+        { .buffer = gfx->draw_arguments, .cycle = false },
+        { .buffer = gfx->line_demand, .cycle = false },
+    }, 6);
+
+    if (counts[GRAPHICS_CULL_BODIES] && !gfx->splatting) {
+        const HMM_Vec2 half_size = HMM_MulV2F(info->cam->window_size, 0.5f * info->cam->zoom);
+        const struct {
+            HMM_Vec2 view_min;
+            HMM_Vec2 view_max;
+            u32 body_count;
+            f32 density;
+            f32 alpha;
+            u32 argument_offset;
+        } constants = {
+            HMM_SubV2(info->cam->position, half_size),
+            HMM_AddV2(info->cam->position, half_size),
+            sim->body_count,
+            sim->options.density,
+            info->alpha,
+            GRAPHICS_CULL_BODIES * 4
+        };
+
+        SDL_PushGPUComputeUniformData(info->command_buffer, 0, &constants, sizeof(constants));
+        const u32 groups = kernel_bind(&gfx->cull_bodies_kernel, compute_pass, sim->body_count);
+        SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+            sim->positions.buffer,
+            sim->previous_positions.buffer,
+            sim->masses.buffer,
+            gfx->visible[GRAPHICS_CULL_BODIES].buffer,
+            gfx->draw_arguments
+        }, 5);
+        SDL_DispatchGPUCompute(compute_pass, groups, 1, 1);
+    }
+
+    // lines are indexed by slot, so the followed body is looked up in each of them
+    const u32 target = info->cam->target < sim->body_count ? info->cam->target : SELECTION_NONE;
+    if (counts[GRAPHICS_CULL_TRAILS] && info->trails->options.enabled) {
+        graphics_lod_lines(gfx, info, compute_pass, &(GraphicsLodLinesInfo) {
+            .cull = GRAPHICS_CULL_TRAILS,
+            .lines = info->trails->array.buffer,
+            .line_count = trail_count,
+            .line_length = TRAIL_LENGTH,
+            .target = selection_slot(&info->trails->selection, target),
+            .anchor = info->trails->frame,
+            .ring = true,
+            .anchors = info->trails->anchors.buffer
+        });
+    }
+
+    if (counts[GRAPHICS_CULL_TRAJECTORIES] && info->trajectories->options.enabled) {
+        graphics_lod_lines(gfx, info, compute_pass, &(GraphicsLodLinesInfo) {
+            .cull = GRAPHICS_CULL_TRAJECTORIES,
+            .lines = info->trajectories->predicted.positions.buffer,
+            .line_count = trajectory_count,
+            .line_length = PREDICTION_LENGTH,
+            .target = trajectories_slot(info->trajectories, target),
+            .anchor = 0,
+            .ring = false,
+            .vertex_counts = info->trajectories->predicted.vertex_counts.buffer,
+            .times = info->trajectories->predicted.times.buffer,
+            .slots = info->trajectories->drawn_slots.buffer
+        });
+    }
+
+    if (counts[GRAPHICS_CULL_FIELD] && info->field->options.enabled) {
+        graphics_lod_lines(gfx, info, compute_pass, &(GraphicsLodLinesInfo) {
+            .cull = GRAPHICS_CULL_FIELD,
+            .lines = info->field->lines.positions.buffer,
+            .line_count = field_line_count,
+            .line_length = FIELD_LINE_LENGTH,
+            .target = (u32) -1,
+            .anchor = 0,
+            .ring = false,
+            .vertex_counts = info->field->lines.vertex_counts.buffer
+        });
+    }
+
+    SDL_EndGPUComputePass(compute_pass);
+    graphics_lod_download(gfx, info);
+}
+
+static void graphics_contours(Graphics *gfx, const GraphicsDrawInfo *info) {
+    const FieldGrid *grid = &info->field->grid;
+    gfx->contouring = gfx->options.equipotentials && grid->valid && grid->size[0] > 1 && grid->size[1] > 1;
+    if (!gfx->contouring) return;
+
+    // the previous segments stay valid until the grid is resampled or the levels change
+    const GraphicsContourState contoured = {
+        .grid_version = grid->version,
+        .base = gfx->options.contour_base,
+        .ratio = gfx->options.contour_ratio,
+        .levels = gfx->options.contour_levels,
+        .valid = true
+    };
+    if (gfx->contoured.valid
+        && gfx->contoured.grid_version == contoured.grid_version
+        && gfx->contoured.base == contoured.base
+        && gfx->contoured.ratio == contoured.ratio
+        && gfx->contoured.levels == contoured.levels) return;
+    gfx->contoured = contoured;
+
+    // every level can cross every cell, twice at a saddle. the base and ratio are kept where the levels stay apart
+    const u32 levels = (u32) SDL_clamp(gfx->options.contour_levels, 0, CONTOUR_MAX_LEVELS);
+    const f32 base = SDL_max(gfx->options.contour_base, CONTOUR_BASE_MIN);
+    const f32 ratio = SDL_max(gfx->options.contour_ratio, CONTOUR_RATIO_MIN);
+    const u32 cell_count = (grid->size[0] - 1) * (grid->size[1] - 1);
+    const u32 capacity = 2 * CONTOUR_SEGMENTS_PER_LEVEL * SDL_max(levels, 1) * cell_count;
+    ReserveGPUArray(&gfx->contours, info->gpu, capacity * sizeof(HMM_Vec2));
+
+    const SDL_GPUIndirectDrawCommand arguments = { .num_instances = 1 };
+    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(info->command_buffer);
+    WriteToGPUBuffers(info->gpu, copy_pass, &(WriteGPUBufferBinding) {
+        .buffer = gfx->contour_arguments,
+        .source = (const u8*) &arguments,
+        .size = sizeof(arguments)
+    }, 1);
+    SDL_EndGPUCopyPass(copy_pass);
+
+    // levels are given in mass per distance, the grid stores potential with gravity already applied
+    const struct {
+        HMM_Vec2 grid_origin;
+        u32 grid_size[2];
+        f32 grid_cell;
+        f32 level_base;
+        f32 level_ratio;
+        u32 level_count;
+        u32 capacity;
+    } constants = {
+        grid->origin,
+        { grid->size[0], grid->size[1] },
+        grid->cell_size,
+        base * info->sim->options.gravity,
+        ratio,
+        levels,
+        capacity
+    };
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(info->command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = gfx->contours.buffer, .cycle = true },
+        { .buffer = gfx->contour_arguments, .cycle = false },
+    }, 2);
+    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &constants, sizeof(constants));
+    const u32 groups = kernel_bind(&gfx->contour_kernel, compute_pass, cell_count);
+    const u32 groups_x = SDL_min(groups, MAX_WORKGROUP_COUNT);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        grid->cells.buffer,
+        gfx->contours.buffer,
+        gfx->contour_arguments
+    }, 3);
+    SDL_DispatchGPUCompute(compute_pass, groups_x, (groups + groups_x - 1) / groups_x, 1);
+    SDL_EndGPUComputePass(compute_pass);
+}
+
+static void graphics_splat_draw(
+    const Graphics *gfx,
+    SDL_GPURenderPass *render_pass,
+    SDL_GPUCommandBuffer *command_buffer,
+    const GPUArray *splat,
+    const u32 width,
+    const f32 exposure
+) {
+    const struct {
+        u32 width;
+        f32 exposure;
+    } constants = { width, exposure };
+
+    SDL_BindGPUGraphicsPipeline(render_pass, gfx->splat_pipeline);
+    SDL_PushGPUFragmentUniformData(command_buffer, 0, &constants, sizeof(constants));
+    SDL_BindGPUFragmentStorageBuffers(render_pass, 0, &splat->buffer, 1);
+    SDL_DrawGPUPrimitives(render_pass, 4, 1, 0, 0);
 }
 
 static void graphics_ghost_draw(const Graphics *gfx, const Ghost *ghost, SDL_GPURenderPass *render_pass) {
@@ -206,56 +730,117 @@ static void graphics_ghost_draw(const Graphics *gfx, const Ghost *ghost, SDL_GPU
 static void graphics_trails_draw(
     const Graphics *gfx,
     const Trails *trails,
-    const Simulation *sim,
-    SDL_GPURenderPass *render_pass
+    const SimulationFrame *sim,
+    const Camera *cam,
+    SDL_GPURenderPass *render_pass,
+    SDL_GPUCommandBuffer *command_buffer
 ) {
-    if (!sim->body_count || !gfx->options.trails) return;
+    if (!trails->residency.resident || !selection_count(&trails->selection) || !trails->options.enabled) return;
     SDL_BindGPUGraphicsPipeline(render_pass, gfx->trail_pipeline);
-    SDL_BindGPUVertexStorageBuffers(render_pass, 0, (SDL_GPUBuffer*[]) { trails->array.buffer, gfx->colors.buffer }, 2);
-    SDL_DrawGPUPrimitives(render_pass, TRAIL_LENGTH, sim->body_count, 0, 0);
+    SDL_BindGPUVertexStorageBuffers(render_pass, 0, (SDL_GPUBuffer*[]) {
+        trails->array.buffer,
+        gfx->colors.buffer,
+        gfx->visible[GRAPHICS_CULL_TRAILS].buffer,
+        trails->bodies.buffer,
+        trails->anchors.buffer,
+        sim->positions.buffer,
+        sim->previous_positions.buffer
+    }, 7);
+
+    const u32 target = selection_slot(&trails->selection, cam->target);
+    SDL_PushGPUVertexUniformData(command_buffer, 3, &target, sizeof(target));
+    SDL_DrawGPUPrimitivesIndirect(render_pass, gfx->draw_arguments, GRAPHICS_CULL_TRAILS * sizeof(SDL_GPUIndirectDrawCommand), 1);
 }
 
 static void graphics_trajectories_draw(
     const Graphics *gfx,
     const Trajectories *trajectories,
-    const Simulation *sim,
-    const Ghost *ghost,
-    SDL_GPURenderPass *render_pass
+    const SimulationFrame *sim,
+    const Camera *cam,
+    SDL_GPURenderPass *render_pass,
+    SDL_GPUCommandBuffer *command_buffer
 ) {
-    if (!trajectories->options.enabled) return;
-    u32 trajectory_count = sim->body_count;
-    if (ghost->enabled) trajectory_count += 1;
-    if (!trajectory_count) return;
+    if (!trajectories->options.enabled || !trajectories_count(trajectories)) return;
 
     SDL_BindGPUGraphicsPipeline(render_pass, gfx->trajectory_pipeline);
-    SDL_BindGPUVertexStorageBuffers(render_pass, 0, (SDL_GPUBuffer*[]) { trajectories->positions.buffer, gfx->colors.buffer }, 2);
-    SDL_DrawGPUPrimitives(render_pass, PREDICTION_LENGTH, trajectory_count, 0, 0);
+    SDL_BindGPUVertexStorageBuffers(render_pass, 0, (SDL_GPUBuffer*[]) {
+        trajectories->predicted.positions.buffer,
+        gfx->colors.buffer,
+        sim->previous_positions.buffer,
+        gfx->visible[GRAPHICS_CULL_TRAJECTORIES].buffer,
+        trajectories->predicted.times.buffer,
+        trajectories->predicted.vertex_counts.buffer,
+        trajectories->predicted.bodies.buffer
+    }, 7);
+
+    // predictions fade out towards the horizon
+    const struct {
+        f32 horizon;
+        u32 target;
+    } trajectory = {
+        (f32) trajectories->computed.horizon,
+        trajectories_slot(trajectories, cam->target)
+    };
+    SDL_PushGPUVertexUniformData(command_buffer, 3, &trajectory, sizeof(trajectory));
+    SDL_DrawGPUPrimitivesIndirect(render_pass, gfx->draw_arguments, GRAPHICS_CULL_TRAJECTORIES * sizeof(SDL_GPUIndirectDrawCommand), 1);
 }
 
-static void graphics_field_draw(const Graphics *gfx, const Field *field, SDL_GPURenderPass *render_pass) {
-    if (!field->line_count || !field->options.enabled) return;
+static void graphics_field_draw(const Graphics *gfx, const Field *field, SDL_GPURenderPass *render_pass, SDL_GPUCommandBuffer *command_buffer) {
+    if (!field->traced.valid || !field->traced.line_count || !field->options.enabled) return;
     SDL_BindGPUGraphicsPipeline(render_pass, gfx->field_pipeline);
     SDL_BindGPUVertexStorageBuffers(render_pass, 0, (SDL_GPUBuffer*[]) {
-        field->lines.buffer,
-        field->line_ids.buffer,
-        gfx->colors.buffer
-    }, 3);
-    SDL_DrawGPUPrimitives(render_pass, FIELD_LINE_LENGTH, field->line_count, 0, 0);
+        field->lines.positions.buffer,
+        field->lines.line_ids.buffer,
+        gfx->colors.buffer,
+        gfx->visible[GRAPHICS_CULL_FIELD].buffer,
+        field->lines.distances.buffer,
+        field->lines.vertex_counts.buffer
+    }, 6);
+
+    // lines fade out over the arc length they were traced to, or less for one that ended early
+    const f32 extent = FIELD_LINE_EXTENT * field->traced.options.line_step;
+    SDL_PushGPUVertexUniformData(command_buffer, 2, &extent, sizeof(extent));
+    SDL_DrawGPUPrimitivesIndirect(render_pass, gfx->draw_arguments, GRAPHICS_CULL_FIELD * sizeof(SDL_GPUIndirectDrawCommand), 1);
 }
 
 static void graphics_potential_draw(
     const Graphics *gfx,
-    const Simulation *sim,
+    const SimulationFrame *sim,
+    const Field *field,
     SDL_GPURenderPass *render_pass,
     SDL_GPUCommandBuffer *command_buffer
 ) {
-    if (!gfx->options.potential) return;
+    if (!gfx->options.potential || !field->grid.valid) return;
+    const struct {
+        HMM_Vec2 grid_origin;
+        u32 grid_size[2];
+        f32 grid_cell;
+        f32 G;
+    } constants = {
+        field->grid.origin,
+        { field->grid.size[0], field->grid.size[1] },
+        field->grid.cell_size,
+        sim->options.gravity
+    };
+
     SDL_BindGPUGraphicsPipeline(render_pass, gfx->potential_pipeline);
-    SDL_PushGPUFragmentUniformData(command_buffer, 0, &sim->body_count, sizeof(sim->body_count));
-    SDL_BindGPUFragmentStorageBuffers(render_pass, 0, (SDL_GPUBuffer*[]) { sim->positions_a.buffer, sim->masses.buffer }, 2);
+    SDL_PushGPUFragmentUniformData(command_buffer, 0, &constants, sizeof(constants));
+    SDL_BindGPUFragmentStorageBuffers(render_pass, 0, &field->grid.cells.buffer, 1);
     SDL_DrawGPUPrimitives(render_pass, 4, 1, 0, 0);
 }
 
+static void graphics_contours_draw(
+    const Graphics *gfx,
+    SDL_GPURenderPass *render_pass,
+    SDL_GPUCommandBuffer *command_buffer
+) {
+    if (!gfx->contouring) return;
+    SDL_BindGPUGraphicsPipeline(render_pass, gfx->contour_pipeline);
+    SDL_PushGPUVertexUniformData(command_buffer, 3, &gfx->options.contour_color, sizeof(gfx->options.contour_color));
+    SDL_BindGPUVertexStorageBuffers(render_pass, 0, &gfx->contours.buffer, 1);
+    SDL_DrawGPUPrimitivesIndirect(render_pass, gfx->contour_arguments, 0, 1);
+}
+
 static void graphics_gui_draw(SDL_GPUCommandBuffer *command_buffer, SDL_GPUTexture *swapchain) {
     ImDrawData *draw_data = ImGui_GetDrawData();
     cImGui_ImplSDLGPU3_PrepareDrawData(draw_data, command_buffer);
@@ -277,5 +862,22 @@ void graphics_free(const Graphics *gfx, SDL_GPUDevice *gpu) {
     SDL_ReleaseGPUGraphicsPipeline(gpu, gfx->trajectory_pipeline);
     SDL_ReleaseGPUGraphicsPipeline(gpu, gfx->field_pipeline);
     SDL_ReleaseGPUGraphicsPipeline(gpu, gfx->ghost_body_pipeline);
+    SDL_ReleaseGPUGraphicsPipeline(gpu, gfx->potential_pipeline);
+    SDL_ReleaseGPUGraphicsPipeline(gpu, gfx->splat_pipeline);
+    SDL_ReleaseGPUGraphicsPipeline(gpu, gfx->contour_pipeline);
+    kernel_free(&gfx->splat_clear_kernel, gpu);
+    kernel_free(&gfx->splat_kernel, gpu);
+    kernel_free(&gfx->splat_tracers_kernel, gpu);
+    kernel_free(&gfx->cull_bodies_kernel, gpu);
+    kernel_free(&gfx->lod_lines_kernel, gpu);
+    kernel_free(&gfx->contour_kernel, gpu);
+    for (u32 i = 0; i < GRAPHICS_CULL_COUNT; i++) SDL_ReleaseGPUBuffer(gpu, gfx->visible[i].buffer);
+    SDL_ReleaseGPUBuffer(gpu, gfx->draw_arguments);
+    SDL_ReleaseGPUBuffer(gpu, gfx->line_demand);
+    for (u32 i = 0; i < LOD_READBACK_FRAMES; i++) SDL_ReleaseGPUTransferBuffer(gpu, gfx->demand_readbacks[i]);
+    SDL_ReleaseGPUBuffer(gpu, gfx->contours.buffer);
+    SDL_ReleaseGPUBuffer(gpu, gfx->contour_arguments);
     SDL_ReleaseGPUBuffer(gpu, gfx->colors.buffer);
+    SDL_ReleaseGPUBuffer(gpu, gfx->splat.buffer);
+    SDL_ReleaseGPUBuffer(gpu, gfx->tracer_splat.buffer);
 }
@@ -1,9 +1,13 @@
+#include <float.h>
 #include "gui.h"
+#include "scheduler.h"
 #include "simulation.h"
 #include "camera.h"
 #include "ghost.h"
+#include "trails.h"
 #include "trajectories.h"
 #include "field.h"
+#include "tracers.h"
 #include "graphics.h"
 
 #include "backends/dcimgui_impl_sdl3.h"
@@ -35,9 +39,10 @@ void gui_init(Gui *gui, SDL_Window *window, SDL_GPUDevice *gpu) {
 }
 
 static void HelpMarker(const char *desc);
-static void gui_controls(SimulationOptions *sim, Ghost *ghost);
-static void gui_visualizations(GraphicsOptions *graphics, TrajectoryOptions *trajectories, FieldOptions *field);
-static void gui_options(ApplicationOptions *app, SimulationOptions *sim, GraphicsOptions *gfx);
+static void gui_controls(SimulationOptions *sim, const SimulationFrame *frame, const Scheduler *scheduler, Ghost *ghost);
+static void gui_followed(const GuiUpdateInfo *info);
+static void gui_visualizations(GraphicsOptions *graphics, Trails *trails, Trajectories *trajectories, Field *field, Tracers *tracers);
+static void gui_options(ApplicationOptions *app, SchedulerOptions *scheduler, SimulationOptions *sim, GraphicsOptions *gfx);
 void gui_update(const GuiUpdateInfo *info) {
     cImGui_ImplSDLGPU3_NewFrame();
     cImGui_ImplSDL3_NewFrame();
@@ -46,18 +51,22 @@ void gui_update(const GuiUpdateInfo *info) {
     static bool open = true;
     if (open) {
         ImGui_Begin("HYENA: N-Body Simulator", &open, ImGuiWindowFlags_AlwaysAutoResize);
-        gui_controls(&info->sim->options, info->ghost);
-        gui_visualizations(&info->gfx->options, &info->trajectories->options, &info->field->options);
-        gui_options(info->app, &info->sim->options, &info->gfx->options);
+        gui_controls(info->sim, info->frame, info->scheduler, info->ghost);
+        gui_followed(info);
+        gui_visualizations(&info->gfx->options, info->trails, info->trajectories, info->field, info->tracers);
+        gui_options(info->app, &info->scheduler->options, info->sim, &info->gfx->options);
         ImGui_End();
     }
 
     ImGui_Render();
 }
 
-static void gui_controls(SimulationOptions *sim, Ghost *ghost) {
+static void gui_controls(SimulationOptions *sim, const SimulationFrame *frame, const Scheduler *scheduler, Ghost *ghost) {
     if (ImGui_CollapsingHeader("Controls", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui_Checkbox("Pause", &sim->paused);
+        ImGui_SameLine();
+        ImGui_Text("Time dilation: %.2fx%s", frame->time_dilation, frame->behind || scheduler->behind ? " (falling behind)" : "");
+        HelpMarker("How fast simulated time is passing compared to real time. Drops below 1x when the simulation can't keep up within its time budget.");
         ImGui_Checkbox("Create bodies!", &ghost->enabled);
         HelpMarker("To create a new body: activate body creation mode, hold right click where you want to create the new body, drag out its velocity, and release!");
         if (ghost->enabled) {
@@ -67,41 +76,125 @@ static void gui_controls(SimulationOptions *sim, Ghost *ghost) {
             HelpMarker("The color of the new body.");
             ImGui_Checkbox("Movable", &ghost->movable);
             HelpMarker("Whether the body should be simulated or remain in place.");
+            ImGui_Checkbox("Trail", &ghost->trail);
+            ImGui_SameLine();
+            ImGui_Checkbox("Trajectory", &ghost->trajectory);
+            ImGui_SameLine();
+            ImGui_Checkbox("Field Lines", &ghost->field_lines);
+            HelpMarker("Which visualizations the new body takes part in. Leaving most bodies out keeps big scenes cheap, it still pulls on everything either way.");
         }
     }
 }
 
-static void gui_visualizations(GraphicsOptions *graphics, TrajectoryOptions *trajectories, FieldOptions *field) {
+// the body the camera follows can be taken in or out of each visualization
+static void gui_followed(const GuiUpdateInfo *info) {
+    const u32 body = info->cam->target;
+    if (body >= info->frame->body_count) return;
+    if (ImGui_CollapsingHeader("Followed Body", ImGuiTreeNodeFlags_DefaultOpen)) {
+        bool trail = selection_contains(&info->trails->selection, body);
+        bool trajectory = selection_contains(&info->trajectories->selection, body);
+        bool field_lines = selection_contains(&info->field->selection, body);
+        if (ImGui_Checkbox("Trail##followed", &trail)) trails_select(info->trails, body, info->cam->position, trail);
+        ImGui_SameLine();
+        if (ImGui_Checkbox("Trajectory##followed", &trajectory)) trajectories_select(info->trajectories, body, trajectory);
+        ImGui_SameLine();
+        if (ImGui_Checkbox("Field Lines##followed", &field_lines)) field_select(info->field, body, field_lines);
+        HelpMarker("Which visualizations the followed body takes part in. Its trajectory is predicted while it's followed either way, so the others can be drawn relative to it.");
+    }
+}
+
+static void gui_progress(const bool busy, const u32 progress, const u32 length) {
+    if (!busy) return;
+    char overlay[32];
+    SDL_snprintf(overlay, sizeof(overlay), "%u/%u", progress, length);
+    ImGui_ProgressBar((f32) progress / (f32) length, (ImVec2) { -1.0f, 0.0f }, overlay);
+}
+
+static void gui_visualizations(GraphicsOptions *graphics, Trails *trails_module, Trajectories *trajectories_module, Field *field_module, Tracers *tracers_module) {
+    TrailOptions *trails = &trails_module->options;
+    TrajectoryOptions *trajectories = &trajectories_module->options;
+    FieldOptions *field = &field_module->options;
+    TracerOptions *tracers = &tracers_module->options;
     if (ImGui_CollapsingHeader("Visualizations", ImGuiTreeNodeFlags_DefaultOpen)) {
-        ImGui_Checkbox("Show body trails", &graphics->trails);
-        HelpMarker("Show where the bodies have been.");
+        ImGui_Checkbox("Show body trails", &trails->enabled);
+        HelpMarker("Show where the bodies have been. Like every visualization, its memory is given back once it's been off for a while.");
+        if (trails->enabled) {
+            ImGui_SliderInt("Trail Sample Steps", &trails->sample_steps, 1, TRAIL_SAMPLE_STEPS_MAX);
+            HelpMarker("Simulation steps between trail points. Trails keep a fixed number of points, so more steps between them reach further back in time.");
+        }
 
         ImGui_Checkbox("Show body trajectories", &trajectories->enabled);
         HelpMarker("Simulate bodies into the future and draw their trajectories (expensive compute for lots of bodies!)");
-        if (trajectories->enabled) ImGui_DragFloat("Trajectory Time Step Multiplier", &trajectories->delta_time_multiplier);
+        if (trajectories->enabled) {
+            ImGui_DragFloat("Trajectory Time Step Multiplier", &trajectories->delta_time_multiplier);
+            ImGui_DragIntEx("Trajectory Horizon", &trajectories->horizon, 64.0f, 1, TRAJECTORY_HORIZON_MAX, "%d steps", ImGuiSliderFlags_AlwaysClamp);
+            HelpMarker("How many steps ahead bodies are predicted. Longer horizons cost time but no extra memory, until a prediction runs out of vertices and stops short.");
+            ImGui_DragFloat("Trajectory Sample Distance", &trajectories->sample_distance);
+            HelpMarker("The furthest a prediction goes between drawn vertices. Vertices are kept more often where it turns, so straight stretches are cheap and close passes stay smooth.");
+            ImGui_Checkbox("Predict Ghost Separately", &trajectories->ghost_ephemeris);
+            HelpMarker("Treat the body being created as too light to pull on the others, so dragging it only re-predicts its own path through the other bodies' existing predictions. Turn off to see how a heavy body would change everyone's future.");
+            gui_progress(trajectories_module->busy, trajectories_module->progress, trajectories_steps(&trajectories_module->computing));
+        }
 
         ImGui_Checkbox("Show gravitational field", &field->enabled);
         HelpMarker("The gravitational field represented with streamlines (expensive compute for lots of bodies!)");
         if (field->enabled) {
-            ImGui_DragFloat("Field Line Volume", &field->line_volume);
+            ImGui_SliderInt("Field Line Budget", &field->line_budget, 1, FIELD_LINE_BUDGET_MAX);
+            HelpMarker("How many field lines there are in total, shared out between bodies in proportion to their mass.");
             ImGui_DragFloat("Field Line Step", &field->line_step);
+            HelpMarker("The typical distance between field line vertices. Steps shrink where lines bend and grow where they're straight, and every line reaches about a thousand of them.");
+            gui_progress(field_module->busy, field_module->progress, FIELD_LINE_LENGTH);
+        }
+
+        if (field->enabled || graphics->potential || graphics->equipotentials) {
+            ImGui_SliderFloatEx("Field Grid Resolution", &field->grid_resolution, 10.0f, 100.0f, "%.0f%%", 0);
+            HelpMarker("Gravity is sampled on a grid over the screen, this is its resolution as a percentage of the screen's. Lower is faster but blurrier.");
+            ImGui_SliderFloat("Field Grid Threshold", &field->grid_threshold, 0.0f, 1.0f);
+            HelpMarker("How far, in grid cells, bodies may move or the zoom may change before the grid is sampled again.");
+        }
+
+        ImGui_Checkbox("Show tracer particles", &tracers->enabled);
+        HelpMarker("Massless test particles that feel the bodies' gravity without pulling back, showing how the field moves matter around.");
+        if (tracers->enabled) {
+            ImGui_SliderInt("Tracer Count", &tracers->count, 1, TRACER_COUNT_MAX);
+            ImGui_DragFloat("Tracer Disk Radius", &tracers->radius);
+            HelpMarker("Tracers are scattered over a disk this wide around the center of mass, each on a circular orbit.");
+            if (ImGui_Button("Reseed Tracers")) tracers_reseed(tracers_module);
+            ImGui_ColorEdit3("Tracer Color", (f32*) &graphics->tracer_color, 0);
+            ImGui_SliderFloat("Tracer Exposure", &graphics->tracer_exposure, 0.0f, 1.0f);
+            HelpMarker("How quickly overlapping tracers saturate to full brightness.");
         }
 
         ImGui_Checkbox("Show gravitational potential", &graphics->potential);
         HelpMarker("The gravitational potential represented with color intensity.");
+
+        ImGui_Checkbox("Show equipotential lines", &graphics->equipotentials);
+        HelpMarker("Lines of constant gravitational potential, spaced geometrically from the base level.");
+        if (graphics->equipotentials) {
+            ImGui_SliderInt("Equipotential Levels", &graphics->contour_levels, 1, CONTOUR_MAX_LEVELS);
+            ImGui_DragFloatEx("Equipotential Base Level", &graphics->contour_base, 0.01f, CONTOUR_BASE_MIN, FLT_MAX, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+            HelpMarker("The lowest level drawn, in mass per distance.");
+            ImGui_DragFloatEx("Equipotential Level Ratio", &graphics->contour_ratio, 0.01f, CONTOUR_RATIO_MIN, FLT_MAX, "%.3f", ImGuiSliderFlags_AlwaysClamp);
+            HelpMarker("Each level is this many times the one before it.");
+            ImGui_ColorEdit3("Equipotential Color", (f32*) &graphics->contour_color, 0);
+        }
     }
 }
 
-static void gui_options(ApplicationOptions *app, SimulationOptions *sim, GraphicsOptions *gfx) {
+static void gui_options(ApplicationOptions *app, SchedulerOptions *scheduler, SimulationOptions *sim, GraphicsOptions *gfx) {
     if (ImGui_CollapsingHeader("Options", 0)) {
         ImGui_SeparatorText("Simulation Options");
         ImGui_DragFloat("Time Step", &app->fixed_delta_time);
+        ImGui_SliderFloat("Simulation Budget", &scheduler->budget, 0.05f, 1.0f);
+        HelpMarker("The fraction of each frame the GPU may spend simulating. Trajectories and field lines are computed over several frames with whatever the simulation leaves over.");
         ImGui_DragFloat("Gravity Coefficient", &sim->gravity);
         HelpMarker("Strength of the gravitational force between two bodies.");
         ImGui_DragFloat("Softening Coefficient", &sim->softening);
         HelpMarker("How much to reduce the gravitational force between two bodies on close encounter for numerical stability.");
         ImGui_DragFloat("Density Coefficient", &sim->density);
         HelpMarker("How dense each body is.");
+        ImGui_Checkbox("Cache Static Field", &sim->static_field);
+        HelpMarker("Once there are many non-movable bodies, their pull is sampled onto a grid whenever one is added instead of being summed on every step. Much faster for large fixed mass distributions, but the pull is slightly blurred up close, so orbits can differ from the exact sum. Off by default.");
         const char *integrators[] = { "Semi-Implicit Euler", "Velocity Verlet", "Runge-Kutta 4" };
         ImGui_ComboChar("Integrator", (i32*) &sim->integrator, integrators, IM_COUNTOF(integrators));
         HelpMarker("The algorithm used to calculate the new velocity and position of each body given the acceleration. Euler is the most performant, Verlet is more accurate while still conserving energy, and RK4 is the most accurate across short time spans but does not conserve energy.");
@@ -114,6 +207,12 @@ static void gui_options(ApplicationOptions *app, SimulationOptions *sim, Graphic
         HelpMarker("The thickness of the outline around non-movable bodies.");
         ImGui_SliderFloat("Trail brightness", &gfx->trail_brightness, 0.0f, 1.0f);
         HelpMarker("The brightness of the trail that each body leaves behind as it moves.");
+        ImGui_SliderFloat("Density Splat Threshold", &gfx->splat_threshold, 0.0f, 8.0f);
+        HelpMarker("Once every body is smaller than this many pixels, bodies are drawn as an accumulated mass density instead of individual circles. Set to 0 to always draw circles.");
+        ImGui_SliderFloat("Density Splat Exposure", &gfx->splat_exposure, 0.0f, 0.1f);
+        HelpMarker("How quickly accumulated mass saturates to full brightness when drawing densities.");
+        ImGui_SliderFloat("Line Detail Error", &gfx->lod_error, 0.0f, 4.0f);
+        HelpMarker("How far in pixels trails, trajectories and field lines may stray from their exact shape when vertices are dropped. Set to 0 to draw every vertex.");
     }
 }
 
@@ -0,0 +1,185 @@
+#include "kernel.h"
+#include "shader_cache.h"
+#include "sdl_utils.h"
+
+#include "SDL3/SDL_filesystem.h"
+#include "SDL3/SDL_timer.h"
+#include "HandmadeMath.h"
+
+static const u32 workgroup_sizes[WORKGROUP_SIZE_COUNT] = WORKGROUP_SIZES;
+static u32 preferred_size = WORKGROUP_SIZE_DEFAULT;
+
+// positions, starting positions, velocities, masses, movable indices, static positions, static masses, static field
+#define AUTOTUNE_BUFFER_COUNT 8
+
+// the size is kept for one driver and device, the key naming them on the first line and the size on the next
+static bool kernel_load_tuning(const char *path, const char *key) {
+    usize size;
+    char *contents = SDL_LoadFile(path, &size);
+    if (!contents) return false;
+
+    u32 cached_size = 0;
+    char *end = SDL_strchr(contents, '\n');
+    if (end) *end = '\0';
+    bool found = end && SDL_strcmp(contents, key) == 0 && SDL_sscanf(end + 1, "%u", &cached_size) == 1;
+    SDL_free(contents);
+
+    // ignore sizes that are no longer compiled
+    bool valid = false;
+    for (u32 i = 0; i < WORKGROUP_SIZE_COUNT; i++) valid |= workgroup_sizes[i] == cached_size;
+    if (found && valid) preferred_size = cached_size;
+    return found && valid;
+}
+
+static f32 kernel_time(SDL_GPUDevice *gpu, SDL_GPUComputePipeline *pipeline, const u32 size, SDL_GPUBuffer **buffers) {
+    // every body movable and none static, so the static field is never sampled
+    const struct {
+        HMM_Vec2 grid_origin;
+        u32 grid_size[2];
+        HMM_Vec2 static_center;
+        f32 grid_cell;
+        u32 movable_count;
+        u32 static_count;
+        f32 gravity;
+        f32 softening;
+        f32 delta_time;
+        f32 static_mass;
+        u32 static_cached;
+    } constants = {
+        .movable_count = AUTOTUNE_BODY_COUNT,
+        .static_count = 0,
+        .gravity = GRAVITY_DEFAULT,
+        .softening = SOFTENING_DEFAULT,
+        .delta_time = FIXED_DELTA_TIME_DEFAULT,
+        .static_cached = false
+    };
+
+    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(gpu);
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = buffers[0], .cycle = false },
+        { .buffer = buffers[1], .cycle = false },
+        { .buffer = buffers[2], .cycle = false },
+    }, 3);
+
+    SDL_PushGPUComputeUniformData(command_buffer, 0, &constants, sizeof(constants));
+    SDL_BindGPUComputePipeline(compute_pass, pipeline);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, buffers, AUTOTUNE_BUFFER_COUNT);
+    for (u32 i = 0; i < AUTOTUNE_DISPATCHES; i++) SDL_DispatchGPUCompute(compute_pass, (AUTOTUNE_BODY_COUNT + size - 1) / size, 1, 1);
+    SDL_EndGPUComputePass(compute_pass);
+
+    const u64 start = SDL_GetTicksNS();
+    SDL_GPUFence *fence = SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer);
+    SDL_WaitForGPUFences(gpu, true, &fence, 1);
+    SDL_ReleaseGPUFence(gpu, fence);
+    return (f32) (SDL_GetTicksNS() - start) / (f32) SDL_NS_PER_SECOND;
+}
+
+void kernel_autotune(SDL_GPUDevice *gpu) {
+    // the same driver can sit in front of very different GPUs, so the device is part of the key too
+    const char *device = SDL_GetStringProperty(SDL_GetGPUDeviceProperties(gpu), SDL_PROP_GPU_DEVICE_NAME_STRING, "unknown device");
+    char key[256];
+    SDL_snprintf(key, sizeof(key), "%s %s", SDL_GetGPUDeviceDriver(gpu), device);
+
+    char *pref_path = SDL_GetPrefPath(PREF_ORGANIZATION, PREF_APPLICATION);
+    char tuning_path[1024] = { 0 };
+    if (pref_path) SDL_snprintf(tuning_path, sizeof(tuning_path), "%sworkgroup.txt", pref_path);
+    SDL_free(pref_path);
+    if (tuning_path[0] && kernel_load_tuning(tuning_path, key)) return;
+
+    // every kernel loops over all bodies the same way, so the integrator stands in for all of them
+    ComputeKernel euler;
+    if (!kernel_init(&euler, gpu, "shaders/simulation/euler.comp")) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "kernel_init() in kernel_autotune(): Couldn't load the euler kernel, keeping workgroup size %u.\n", preferred_size);
+        return;
+    }
+
+    HMM_Vec2 *positions = SDL_calloc(AUTOTUNE_BODY_COUNT, sizeof(HMM_Vec2));
+    HMM_Vec2 *velocities = SDL_calloc(AUTOTUNE_BODY_COUNT, sizeof(HMM_Vec2));
+    f32 *ones = SDL_malloc(AUTOTUNE_BODY_COUNT * sizeof(f32));
+    u32 *indices = SDL_malloc(AUTOTUNE_BODY_COUNT * sizeof(u32));
+    for (u32 i = 0; i < AUTOTUNE_BODY_COUNT; i++) {
+        positions[i] = HMM_V2((f32) (i % 64) * 10.0f, (f32) (i / 64) * 10.0f);
+        ones[i] = 1.0f;
+        indices[i] = i;
+    }
+
+    // laid out like simulation_update binds them, the static arrays are only there to fill their bindings
+    const u32 vectors_size = AUTOTUNE_BODY_COUNT * sizeof(HMM_Vec2);
+    const u32 scalars_size = AUTOTUNE_BODY_COUNT * sizeof(f32);
+    const u32 indices_size = AUTOTUNE_BODY_COUNT * sizeof(u32);
+    SDL_GPUBuffer *buffers[AUTOTUNE_BUFFER_COUNT] = {
+        CreateGPUArray(gpu, vectors_size, SDL_GPU_BUFFERUSAGE_READWRITEDRAW).buffer,
+        CreateGPUArray(gpu, vectors_size, SDL_GPU_BUFFERUSAGE_READWRITEDRAW).buffer,
+        CreateGPUArray(gpu, vectors_size, SDL_GPU_BUFFERUSAGE_READWRITEDRAW).buffer,
+        CreateGPUArray(gpu, scalars_size, SDL_GPU_BUFFERUSAGE_READDRAW).buffer,
+        CreateGPUArray(gpu, indices_size, SDL_GPU_BUFFERUSAGE_READDRAW).buffer,
+        CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READDRAW).buffer,
+        CreateGPUArray(gpu, sizeof(f32), SDL_GPU_BUFFERUSAGE_READDRAW).buffer,
+        CreateGPUArray(gpu, sizeof(HMM_Vec4), SDL_GPU_BUFFERUSAGE_READDRAW).buffer,
+    };
+
+    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(gpu);
+    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+    WriteToGPUBuffers(gpu, copy_pass, (WriteGPUBufferBinding[]) {
+        { .buffer = buffers[0], .source = (u8*) positions, .size = vectors_size },
+        { .buffer = buffers[1], .source = (u8*) positions, .size = vectors_size },
+        { .buffer = buffers[2], .source = (u8*) velocities, .size = vectors_size },
+        { .buffer = buffers[3], .source = (u8*) ones, .size = scalars_size },
+        { .buffer = buffers[4], .source = (u8*) indices, .size = indices_size },
+    }, 5);
+    SDL_EndGPUCopyPass(copy_pass);
+    SDL_SubmitGPUCommandBuffer(command_buffer);
+
+    f32 best_time = 0.0f;
+    for (u32 i = 0; i < WORKGROUP_SIZE_COUNT; i++) {
+        kernel_time(gpu, euler.variants[i], workgroup_sizes[i], buffers); // warm up
+        const f32 time = kernel_time(gpu, euler.variants[i], workgroup_sizes[i], buffers);
+        if (i == 0 || time < best_time) {
+            best_time = time;
+            preferred_size = workgroup_sizes[i];
+        }
+    }
+
+    SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Autotuned compute workgroup size for %s: %u\n", key, preferred_size);
+    if (tuning_path[0]) {
+        char contents[sizeof(key) + 16];
+        const i32 length = SDL_snprintf(contents, sizeof(contents), "%s\n%u\n", key, preferred_size);
+        SDL_SaveFile(tuning_path, contents, (usize) length);
+    }
+
+    for (u32 i = 0; i < AUTOTUNE_BUFFER_COUNT; i++) SDL_ReleaseGPUBuffer(gpu, buffers[i]);
+    SDL_free(positions);
+    SDL_free(velocities);
+    SDL_free(ones);
+    SDL_free(indices);
+    kernel_free(&euler, gpu);
+}
+
+bool kernel_init(ComputeKernel *kernel, SDL_GPUDevice *gpu, const char *shader_path) {
+    char paths[WORKGROUP_SIZE_COUNT][256];
+    ShaderCacheLoad loads[WORKGROUP_SIZE_COUNT];
+    for (u32 i = 0; i < WORKGROUP_SIZE_COUNT; i++) {
+        SDL_snprintf(paths[i], sizeof(paths[i]), "%s.%u.spv", shader_path, workgroup_sizes[i]);
+        loads[i].path = paths[i];
+    }
+
+    const bool loaded = shader_cache_load(gpu, loads, WORKGROUP_SIZE_COUNT);
+    for (u32 i = 0; i < WORKGROUP_SIZE_COUNT; i++) kernel->variants[i] = loads[i].pipeline;
+    return loaded;
+}
+
+u32 kernel_bind(const ComputeKernel *kernel, SDL_GPUComputePass *compute_pass, const u32 count) {
+    // the tuned size, unless there's so little work that a smaller workgroup leaves fewer invocations idle
+    const u32 target = SDL_min(count, preferred_size);
+    u32 variant = 0;
+    while (variant + 1 < WORKGROUP_SIZE_COUNT && workgroup_sizes[variant] < target) variant++;
+
+    SDL_BindGPUComputePipeline(compute_pass, kernel->variants[variant]);
+    return (count + workgroup_sizes[variant] - 1) / workgroup_sizes[variant];
+}
+
+void kernel_free(const ComputeKernel *kernel, SDL_GPUDevice *gpu) {
+    for (u32 i = 0; i < WORKGROUP_SIZE_COUNT; i++) {
+        if (kernel->variants[i]) SDL_ReleaseGPUComputePipeline(gpu, kernel->variants[i]);
+    }
+}
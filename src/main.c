@@ -1,9 +1,14 @@
 #include "SDL3/SDL_video.h"
 #include "constants.h"
+#include "kernel.h"
+#include "shader_cache.h"
+#include "scheduler.h"
 #include "simulation.h"
+#include "simulation_thread.h"
 #include "trails.h"
 #include "trajectories.h"
 #include "field.h"
+#include "tracers.h"
 #include "ghost.h"
 #include "camera.h"
 #include "graphics.h"
@@ -19,15 +24,27 @@
 
 #define UNUSED(x) (void)(x)
 
+// a body sent to the simulation, only set up for drawing once the simulation has published it
+typedef struct PendingBody {
+    SimulationAddBodyInfo body;
+    Ghost ghost;
+} PendingBody;
+
 typedef struct {
     ApplicationOptions options;
     SDL_Window *window;
     SDL_GPUDevice *gpu;
 
-    Simulation sim;
+    SimulationThread sim_thread;
+    SimulationOptions sim_options;
+    PendingBody *pending; // stb_ds array
+    u32 body_count; // bodies set up for drawing, never ahead of the published frame
+
+    Scheduler scheduler;
     Trails trails;
     Trajectories trajectories;
     Field field;
+    Tracers tracers;
     Ghost ghost;
     Camera cam;
     Graphics gfx;
@@ -60,78 +77,95 @@ SDL_AppResult SDL_AppInit(void **appstate, const int argc, char **argv) {
     if (!app->gpu) panic("Failed to create GPU device!");
     if (!SDL_ClaimWindowForGPUDevice(app->gpu, app->window)) panic("Failed to claim window for GPU!");
     SDL_SetGPUSwapchainParameters(app->gpu, app->window, SDL_GPU_SWAPCHAINCOMPOSITION_SDR, SDL_GPU_PRESENTMODE_VSYNC);
+    shader_cache_init(app->gpu);
+    kernel_autotune(app->gpu);
 
     // initialize modules
-    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(app->gpu);
-    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(command_buffer);
-
-    if (simulation_init(&app->sim, app->gpu) != 0) panic("Failed to initialize simulation!");
-    if (trails_init(&app->trails, app->gpu) != 0) panic("Failed to initialize trail module!");
-    if (trajectories_init(&app->trajectories, app->gpu) != 0) panic("Failed to initialize trajectory module!");
-    if (field_init(&app->field, app->gpu) != 0) panic("Failed to initialize field line module!");
-    ghost_init(&app->ghost, &app->trajectories, app->gpu, copy_pass);
+    scheduler_init(&app->scheduler);
+    if (simulation_thread_init(&app->sim_thread, app->gpu) != 0) panic("Failed to initialize simulation thread!");
+    app->sim_options = app->sim_thread.sim.options;
+    // visualizations only create their pipelines and buffers once they're first switched on
+    trails_init(&app->trails);
+    trajectories_init(&app->trajectories);
+    field_init(&app->field);
+    tracers_init(&app->tracers);
+    ghost_init(&app->ghost);
     camera_init(&app->cam);
     if (graphics_init(&app->gfx, app->gpu, app->window) != 0) panic("Failed to initialize graphics!");
     gui_init(&app->gui, app->window, app->gpu);
-
-    SDL_EndGPUCopyPass(copy_pass);
-    SDL_SubmitGPUCommandBuffer(command_buffer);
     return SDL_APP_CONTINUE;
 }
 
+static void add_published_bodies(Application *app, const SimulationFrame *sim);
 SDL_AppResult SDL_AppIterate(void *appstate) {
     Application *app = appstate;
     static u64 last_tick = 0;
-    static f32 accumulator = 0.0f;
 
     if (last_tick == 0) last_tick = SDL_GetTicksNS();
     const u64 current_tick = SDL_GetTicksNS();
     const f32 delta_time = (f32)(current_tick - last_tick) / (f32) SDL_NS_PER_SECOND;
     last_tick = current_tick;
 
-    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(app->gpu);
-    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
-        { .buffer = app->sim.positions_a.buffer, .cycle = false },
-        { .buffer = app->sim.positions_b.buffer, .cycle = false },
-        { .buffer = app->sim.velocities.buffer, .cycle = false },
-        { .buffer = app->trails.array.buffer, .cycle = false },
-        { .buffer = app->trajectories.positions.buffer, .cycle = false },
-        { .buffer = app->trajectories.velocities.buffer, .cycle = false },
-    }, 6);
-
-    accumulator += delta_time;
-    while (accumulator >= app->options.fixed_delta_time) {
-        simulation_update(&app->sim, command_buffer, compute_pass, app->options.fixed_delta_time);
-        trajectories_update(&app->trajectories, &(TrajectoriesUpdateInfo) {
-            .command_buffer = command_buffer,
-            .compute_pass = compute_pass,
-            .sim = &app->sim,
-            .ghost = &app->ghost,
-            .delta_time = app->options.fixed_delta_time
-        });
-
-        accumulator -= app->options.fixed_delta_time;
-    }
+    // only the trails read the simulation's history, it's kept for as long as they're resident
+    app->sim_options.history = app->trails.options.enabled || app->trails.residency.resident;
+    simulation_thread_push_options(&app->sim_thread, &app->sim_options, &app->scheduler.options, app->options.fixed_delta_time);
 
-    trails_update(&app->trails, command_buffer, compute_pass, &app->sim);
-    field_update(&app->field, &app->sim, command_buffer, compute_pass);
-    SDL_EndGPUComputePass(compute_pass);
+    // the simulation steps on its own thread, here we only draw whatever it has finished most recently
+    const SimulationFrame *sim = simulation_thread_acquire(&app->sim_thread, app->scheduler.frames_submitted + 1);
+    add_published_bodies(app, sim);
+    const f32 alpha = simulation_frame_alpha(sim, current_tick);
+    scheduler_begin(&app->scheduler, delta_time);
 
-    camera_update(&app->cam, app->window, app->gpu, &app->sim);
-    ghost_update(&app->ghost, app->gpu, &app->sim, &app->cam);
-    trajectories_ghost_update(&app->trajectories, &(TrajectoriesGhostUpdateInfo) {
+    // background jobs each get a slice of whatever budget the simulation left over, the field lines trace
+    // through last frame's grid since this frame's is only resampled after the camera moves
+    trajectories_update(&app->trajectories, &(TrajectoriesUpdateInfo) {
+        .gpu = app->gpu,
+        .scheduler = &app->scheduler,
+        .sim = sim,
         .ghost = &app->ghost,
-        .sim = &app->sim,
+        .delta_time = app->options.fixed_delta_time,
+        .target = app->cam.target
+    });
+    field_update(&app->field, &(FieldUpdateInfo) {
+        .gpu = app->gpu,
+        .scheduler = &app->scheduler,
+        .sim = sim
+    });
+
+    // the field grid covers the viewport, so the camera has to settle before it's sampled
+    camera_update(&app->cam, app->window, app->gpu, sim, alpha);
+    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(app->gpu);
+    field_grid_update(&app->field, &(FieldGridUpdateInfo) {
+        .gpu = app->gpu,
+        .command_buffer = command_buffer,
+        .sim = sim,
+        .cam = &app->cam,
+        .potential = app->gfx.options.potential || app->gfx.options.equipotentials
+    });
+
+    trails_update(&app->trails, &(TrailsUpdateInfo) {
+        .gpu = app->gpu,
+        .command_buffer = command_buffer,
+        .sim = sim
+    });
+    tracers_update(&app->tracers, &(TracersUpdateInfo) {
         .gpu = app->gpu,
         .command_buffer = command_buffer,
+        .scheduler = &app->scheduler,
+        .sim = sim
     });
+    ghost_update(&app->ghost, app->gpu, sim, &app->cam);
 
     gui_update(&(GuiUpdateInfo) {
         .app = &app->options,
-        .sim = &app->sim,
+        .scheduler = &app->scheduler,
+        .sim = &app->sim_options,
+        .frame = sim,
         .ghost = &app->ghost,
+        .trails = &app->trails,
         .trajectories = &app->trajectories,
         .field = &app->field,
+        .tracers = &app->tracers,
         .cam = &app->cam,
         .gfx = &app->gfx,
     });
@@ -140,20 +174,25 @@ SDL_AppResult SDL_AppIterate(void *appstate) {
         .window = app->window,
         .gpu = app->gpu,
         .command_buffer = command_buffer,
-        .sim = &app->sim,
+        .sim = sim,
         .ghost = &app->ghost,
         .trails = &app->trails,
         .trajectories = &app->trajectories,
         .field = &app->field,
+        .tracers = &app->tracers,
         .cam = &app->cam,
+        .alpha = alpha,
+        .frame = app->scheduler.frames_submitted + 1,
+        .frames_retired = app->scheduler.frames_retired,
     });
 
-    SDL_SubmitGPUCommandBuffer(command_buffer);
+    scheduler_submit_frame(&app->scheduler, app->gpu, command_buffer);
+    simulation_thread_retire(&app->sim_thread, app->scheduler.frames_retired);
 
     return SDL_APP_CONTINUE;
 }
 
-static void add_body(Application *app, const SimulationAddBodyInfo *sim_info, SDL_FColor *color);
+static bool add_body(Application *app, const SimulationAddBodyInfo *sim_info, const Ghost *ghost);
 SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
     Application *app = appstate;
     UNUSED(app);
@@ -170,50 +209,75 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event) {
                 .velocity = app->ghost.velocity,
                 .mass = app->ghost.mass,
                 .movable = app->ghost.movable
-            }, &app->ghost.color);
+            }, &app->ghost);
         }
     }
 
     if (!app->gui.io->WantCaptureKeyboard) {
-        camera_keyboard(&app->cam, event, &app->sim);
+        camera_keyboard(&app->cam, event, app->body_count);
         ghost_keyboard(&app->ghost, event);
         if (event->type == SDL_EVENT_KEY_DOWN && event->key.scancode == SDL_SCANCODE_SPACE)
-            app->sim.options.paused = !app->sim.options.paused;
+            app->sim_options.paused = !app->sim_options.paused;
     }
 
     return SDL_APP_CONTINUE;
 }
 
-static void add_body(Application *app, const SimulationAddBodyInfo *sim_info, SDL_FColor *color) {
+// never waits on the simulation, a body that doesn't fit in its queue is dropped and reported
+static bool add_body(Application *app, const SimulationAddBodyInfo *sim_info, const Ghost *ghost) {
+    const SimulationCommand command = { .type = SIMULATION_COMMAND_ADD_BODY, .body = *sim_info };
+    if (!simulation_thread_push(&app->sim_thread, &command)) {
+        SDL_LogWarn(SDL_LOG_CATEGORY_APPLICATION, "add_body(): The simulation queue is full, the body wasn't added.\n");
+        return false;
+    }
+
+    arrput(app->pending, ((PendingBody) { .body = *sim_info, .ghost = *ghost }));
+    return true;
+}
+
+// bodies are set up for drawing in the order they were added, as soon as the simulation has published them
+static void add_published_bodies(Application *app, const SimulationFrame *sim) {
+    if (!arrlen(app->pending) || app->body_count >= sim->body_count) return;
+
     SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(app->gpu);
     SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(command_buffer);
-    u32 body_index = simulation_add_body(&app->sim, app->gpu, copy_pass, sim_info);
-    trails_add_body(&app->trails, app->gpu, copy_pass, sim_info->position);
-    trajectories_add_body(&app->trajectories, app->gpu, copy_pass);
-    field_add_body(&app->field, &(FieldAddBodyInfo) {
-        .gpu = app->gpu,
-        .copy_pass = copy_pass,
-        .index = body_index,
-        .mass = sim_info->mass
-    });
-    graphics_add_body(&app->gfx, app->gpu, copy_pass, color);
+    u32 added = 0;
+    while (added < (u32) arrlen(app->pending) && app->body_count < sim->body_count) {
+        const PendingBody *pending = &app->pending[added++];
+        trails_add_body(&app->trails, app->gpu, copy_pass, pending->body.position, pending->ghost.trail);
+        trajectories_add_body(&app->trajectories, pending->ghost.trajectory);
+        field_add_body(&app->field, pending->ghost.field_lines);
+        graphics_add_body(&app->gfx, &(GraphicsAddBodyInfo) {
+            .gpu = app->gpu,
+            .copy_pass = copy_pass,
+            .color = &pending->ghost.color,
+            .mass = pending->body.mass
+        });
+        app->body_count++;
+    }
+
+    arrdeln(app->pending, 0, added);
     SDL_EndGPUCopyPass(copy_pass);
     SDL_SubmitGPUCommandBuffer(command_buffer);
 }
 
 void SDL_AppQuit(void *appstate, const SDL_AppResult result) {
     UNUSED(result);
-    const Application *app = appstate;
+    Application *app = appstate;
 
+    simulation_thread_free(&app->sim_thread, app->gpu);
     SDL_WaitForGPUIdle(app->gpu);
     SDL_ReleaseWindowFromGPUDevice(app->gpu, app->window);
 
-    simulation_free(&app->sim, app->gpu);
+    scheduler_free(&app->scheduler, app->gpu);
     trails_free(&app->trails, app->gpu);
     trajectories_free(&app->trajectories, app->gpu);
     field_free(&app->field, app->gpu);
+    tracers_free(&app->tracers, app->gpu);
     graphics_free(&app->gfx, app->gpu);
     gui_free();
+    shader_cache_free();
+    arrfree(app->pending);
 
     SDL_DestroyWindow(app->window);
     SDL_DestroyGPUDevice(app->gpu);
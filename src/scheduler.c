@@ -0,0 +1,151 @@
+#include "scheduler.h"
+#include "constants.h"
+
+void scheduler_init(Scheduler *scheduler) {
+    *scheduler = (Scheduler) {
+        .options = (SchedulerOptions) { .budget = SCHEDULER_BUDGET_DEFAULT },
+        .frame_time = FIXED_DELTA_TIME_DEFAULT,
+        .time_dilation = 1.0f,
+    };
+}
+
+static f32 smooth(const f32 average, const f32 sample) {
+    return average + SCHEDULER_SMOOTHING * (sample - average);
+}
+
+void scheduler_begin(Scheduler *scheduler, const f32 delta_time) {
+    scheduler->frame_time = smooth(scheduler->frame_time, delta_time);
+    scheduler->remaining = scheduler->options.budget * scheduler->frame_time;
+    scheduler->behind = false;
+}
+
+u32 scheduler_plan_steps(Scheduler *scheduler, const f32 delta_time, const f32 fixed_delta_time, const bool paused) {
+    if (paused || fixed_delta_time <= 0.0f) {
+        scheduler->accumulator = 0.0f;
+        scheduler->time_dilation = 0.0f;
+        return 0;
+    }
+
+    // never owe more than MAX_ACCUMULATOR_TIME of simulation, anything beyond that is dropped as time dilation
+    scheduler->accumulator = SDL_min(scheduler->accumulator + delta_time, (f32) MAX_ACCUMULATOR_TIME);
+    const u32 wanted = (u32) (scheduler->accumulator / fixed_delta_time);
+
+    // always take at least one step so the simulation can't stall entirely
+    const f32 step_cost = scheduler->costs[SCHEDULER_WORK_STEPS];
+    const u32 affordable = step_cost > 0.0f ? (u32) (SDL_max(scheduler->remaining, 0.0f) / step_cost) : wanted;
+    const u32 steps = SDL_min(wanted, SDL_max(affordable, 1));
+    scheduler->accumulator -= (f32) steps * fixed_delta_time;
+    scheduler->remaining -= (f32) steps * step_cost;
+
+    scheduler->behind |= steps < wanted;
+    if (delta_time > 0.0f) {
+        const f32 dilation = (f32) steps * fixed_delta_time / delta_time;
+        scheduler->time_dilation = smooth(scheduler->time_dilation, dilation);
+    }
+
+    return steps;
+}
+
+u32 scheduler_plan_units(Scheduler *scheduler, const SchedulerWork work, const u32 wanted) {
+    // background jobs are sliced into whatever fits the leftover budget, but always advance a little so they finish.
+    // work that hasn't been measured yet only gets the smallest slice until its first one retires
+    const f32 cost = scheduler->costs[work];
+    const u32 affordable = cost > 0.0f ? (u32) (SDL_max(scheduler->remaining, 0.0f) / cost) : SCHEDULER_MIN_UNITS;
+    const u32 units = SDL_min(wanted, SDL_max(affordable, SCHEDULER_MIN_UNITS));
+    scheduler->remaining -= (f32) units * cost;
+    return units;
+}
+
+// the GPU works through submissions in order, so everything that retired since the last poll shares the time since
+// either the previous poll or its own submission. it's split by what each was expected to cost so one slow kind of
+// work doesn't pass its time on to the rest. polls only happen as often as submissions, so costs err high, which
+// keeps slices small rather than letting them overrun the frame
+static void scheduler_poll(Scheduler *scheduler, SDL_GPUDevice *gpu) {
+    u32 retired = 0;
+    while (retired < scheduler->flight_count) {
+        const SchedulerFlight *flight = &scheduler->flights[(scheduler->flight_head + retired) % SCHEDULER_MAX_FLIGHTS];
+        if (!SDL_QueryGPUFence(gpu, flight->fence)) break;
+        retired++;
+    }
+
+    if (!retired) return;
+    const u64 now = SDL_GetTicksNS();
+    const u64 start = SDL_max(scheduler->flights[scheduler->flight_head].submitted, scheduler->retired);
+    const f32 span = (f32) (now - SDL_min(start, now)) / (f32) SDL_NS_PER_SECOND;
+
+    f32 expected_total = 0.0f;
+    for (u32 i = 0; i < retired; i++) {
+        const SchedulerFlight *flight = &scheduler->flights[(scheduler->flight_head + i) % SCHEDULER_MAX_FLIGHTS];
+        expected_total += (f32) flight->units * SDL_max(scheduler->costs[flight->work], SCHEDULER_MIN_COST);
+    }
+
+    for (u32 i = 0; i < retired; i++) {
+        const SchedulerFlight *flight = &scheduler->flights[(scheduler->flight_head + i) % SCHEDULER_MAX_FLIGHTS];
+        if (flight->units && expected_total > 0.0f) {
+            const f32 share = SDL_max(scheduler->costs[flight->work], SCHEDULER_MIN_COST) / expected_total;
+            // the first measurement is taken as is rather than smoothed up from nothing
+            const f32 sample = span * share;
+            const f32 cost = scheduler->costs[flight->work];
+            scheduler->costs[flight->work] = cost > 0.0f ? smooth(cost, sample) : sample;
+        }
+
+        scheduler->frames_retired += flight->work == SCHEDULER_WORK_FRAME ? 1 : 0;
+        SDL_ReleaseGPUFence(gpu, flight->fence);
+    }
+
+    scheduler->flight_head = (scheduler->flight_head + retired) % SCHEDULER_MAX_FLIGHTS;
+    scheduler->flight_count -= retired;
+    scheduler->retired = now;
+}
+
+// submissions are never waited on unless too many are still in flight, their costs are measured as they retire
+void scheduler_submit(
+    Scheduler *scheduler,
+    SDL_GPUDevice *gpu,
+    SDL_GPUCommandBuffer *command_buffer,
+    const SchedulerWork work,
+    const u32 units
+) {
+    scheduler_poll(scheduler, gpu);
+    if (scheduler->flight_count == SCHEDULER_MAX_FLIGHTS) {
+        SDL_WaitForGPUFences(gpu, true, &scheduler->flights[scheduler->flight_head].fence, 1);
+        scheduler_poll(scheduler, gpu);
+    }
+
+    const u64 submitted = SDL_GetTicksNS();
+    SDL_GPUFence *fence = SDL_SubmitGPUCommandBufferAndAcquireFence(command_buffer);
+    if (!fence) return;
+    scheduler->flights[(scheduler->flight_head + scheduler->flight_count) % SCHEDULER_MAX_FLIGHTS] = (SchedulerFlight) {
+        .fence = fence,
+        .work = work,
+        .units = units,
+        .submitted = submitted
+    };
+    scheduler->flight_count++;
+    scheduler->frames_submitted += work == SCHEDULER_WORK_FRAME ? 1 : 0;
+}
+
+// for a thread that has nothing else to do meanwhile, its submissions are waited on right away so their cost runs
+// from submission to signal rather than up to whenever the next poll happens, which could be after a sleep
+void scheduler_wait(Scheduler *scheduler, SDL_GPUDevice *gpu) {
+    for (u32 i = 0; i < scheduler->flight_count; i++) {
+        SDL_GPUFence *fence = scheduler->flights[(scheduler->flight_head + i) % SCHEDULER_MAX_FLIGHTS].fence;
+        SDL_WaitForGPUFences(gpu, true, &fence, 1);
+    }
+
+    scheduler_poll(scheduler, gpu);
+}
+
+void scheduler_submit_frame(Scheduler *scheduler, SDL_GPUDevice *gpu, SDL_GPUCommandBuffer *command_buffer) {
+    scheduler_submit(scheduler, gpu, command_buffer, SCHEDULER_WORK_FRAME, 1);
+}
+
+void scheduler_free(Scheduler *scheduler, SDL_GPUDevice *gpu) {
+    for (u32 i = 0; i < scheduler->flight_count; i++) {
+        SDL_GPUFence *fence = scheduler->flights[(scheduler->flight_head + i) % SCHEDULER_MAX_FLIGHTS].fence;
+        SDL_WaitForGPUFences(gpu, true, &fence, 1);
+        SDL_ReleaseGPUFence(gpu, fence);
+    }
+
+    scheduler->flight_count = 0;
+}
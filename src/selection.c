@@ -0,0 +1,51 @@
+#include "selection.h"
+
+#include "stb_ds.h"
+
+void selection_add_body(Selection *selection, const bool selected) {
+    const u32 body = (u32) arrlen(selection->slots);
+    arrput(selection->slots, SELECTION_NONE);
+    if (selected) selection_insert(selection, body);
+}
+
+// returns the body's slot, new ones are always appended
+u32 selection_insert(Selection *selection, const u32 body) {
+    if (selection->slots[body] != SELECTION_NONE) return selection->slots[body];
+    const u32 slot = (u32) arrlen(selection->bodies);
+    arrput(selection->bodies, body);
+    selection->slots[body] = slot;
+    selection->version++;
+    return slot;
+}
+
+// returns the slot the body left, which the last slot has been moved into unless it was the last one itself
+u32 selection_remove(Selection *selection, const u32 body) {
+    const u32 slot = selection->slots[body];
+    if (slot == SELECTION_NONE) return SELECTION_NONE;
+    const u32 last = arrpop(selection->bodies);
+    if (last != body) {
+        selection->bodies[slot] = last;
+        selection->slots[last] = slot;
+    }
+
+    selection->slots[body] = SELECTION_NONE;
+    selection->version++;
+    return slot;
+}
+
+u32 selection_slot(const Selection *selection, const u32 body) {
+    return body < (u32) arrlen(selection->slots) ? selection->slots[body] : SELECTION_NONE;
+}
+
+u32 selection_count(const Selection *selection) {
+    return (u32) arrlen(selection->bodies);
+}
+
+bool selection_contains(const Selection *selection, const u32 body) {
+    return selection_slot(selection, body) != SELECTION_NONE;
+}
+
+void selection_free(Selection *selection) {
+    arrfree(selection->slots);
+    arrfree(selection->bodies);
+}
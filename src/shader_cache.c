@@ -0,0 +1,313 @@
+#include "shader_cache.h"
+#include "constants.h"
+#include "kernel.h"
+#include "embedded_shaders.h"
+#include "sdl_utils.h"
+
+#include "SDL3/SDL_cpuinfo.h"
+#include "SDL3/SDL_filesystem.h"
+#include "SDL3/SDL_thread.h"
+#include "SDL3/SDL_atomic.h"
+
+#define SHADER_CACHE_MAGIC 0x4353424E // "NBSC"
+#define SHADER_CACHE_VERSION 1
+#define SHADER_OVERRIDE_VARIABLE "N_BODY_SHADER_ROOT"
+
+typedef struct {
+    u32 magic;
+    u32 version;
+    SDL_GPUShaderFormat format;
+    SDL_ShaderCross_ShaderStage stage;
+    char entrypoint[16];
+    union {
+        SDL_ShaderCross_GraphicsShaderResourceInfo graphics;
+        SDL_ShaderCross_ComputePipelineMetadata compute;
+    };
+    u64 code_size;
+} ShaderCacheHeader;
+
+static SDL_GPUShaderFormat cache_format = SDL_GPU_SHADERFORMAT_INVALID;
+static char cache_directory[1024];
+static EmbeddedShader *override_shaders = NULL; // indexed like EMBEDDED_SHADERS, NULL code where a file was missing
+
+// every shader is read from the override up front, so pipelines created later on, like the ones only made once
+// their feature is first enabled, come from the same build as the rest. recompiling shows up on the next launch
+static void shader_cache_snapshot(const char *root) {
+    override_shaders = SDL_calloc(EMBEDDED_SHADER_COUNT, sizeof(EmbeddedShader));
+    if (!override_shaders) return;
+
+    for (u32 i = 0; i < EMBEDDED_SHADER_COUNT; i++) {
+        char full_path[1024];
+        SDL_snprintf(full_path, sizeof(full_path), "%s/%s", root, EMBEDDED_SHADERS[i].path);
+        override_shaders[i].path = EMBEDDED_SHADERS[i].path;
+        override_shaders[i].code = SDL_LoadFile(full_path, &override_shaders[i].size);
+    }
+}
+
+void shader_cache_init(SDL_GPUDevice *gpu) {
+    // point at a build directory to pick up recompiled shaders without relinking
+    const char *override_root = SDL_getenv(SHADER_OVERRIDE_VARIABLE);
+    if (override_root) {
+        SDL_LogInfo(SDL_LOG_CATEGORY_APPLICATION, "Loading shaders from %s instead of the embedded ones, as they were at startup.\n", override_root);
+        shader_cache_snapshot(override_root);
+    }
+
+    // the formats we can produce from SPIR-V ourselves, anything else goes through SDL_shadercross uncached
+    const SDL_GPUShaderFormat formats = SDL_GetGPUShaderFormats(gpu);
+    if (formats & SDL_GPU_SHADERFORMAT_SPIRV) cache_format = SDL_GPU_SHADERFORMAT_SPIRV;
+    else if (formats & SDL_GPU_SHADERFORMAT_MSL) cache_format = SDL_GPU_SHADERFORMAT_MSL;
+    else if (formats & SDL_GPU_SHADERFORMAT_DXIL) cache_format = SDL_GPU_SHADERFORMAT_DXIL;
+
+    char *pref_path = SDL_GetPrefPath(PREF_ORGANIZATION, PREF_APPLICATION);
+    if (!pref_path) return;
+    SDL_snprintf(cache_directory, sizeof(cache_directory), "%sshaders", pref_path);
+    SDL_free(pref_path);
+    if (!SDL_CreateDirectory(cache_directory)) cache_directory[0] = '\0';
+}
+
+static bool shader_cache_stage(const char *path, SDL_ShaderCross_ShaderStage *stage) {
+    if (SDL_strstr(path, ".vert")) *stage = SDL_SHADERCROSS_SHADERSTAGE_VERTEX;
+    else if (SDL_strstr(path, ".frag")) *stage = SDL_SHADERCROSS_SHADERSTAGE_FRAGMENT;
+    else if (SDL_strstr(path, ".comp")) *stage = SDL_SHADERCROSS_SHADERSTAGE_COMPUTE;
+    else return false;
+    return true;
+}
+
+static const u8 *shader_cache_read(const char *path, usize *size) {
+    const EmbeddedShader *shaders = override_shaders ? override_shaders : EMBEDDED_SHADERS;
+    for (u32 i = 0; i < EMBEDDED_SHADER_COUNT; i++) {
+        if (SDL_strcmp(shaders[i].path, path) != 0) continue;
+        *size = shaders[i].size;
+        return (const u8*) shaders[i].code;
+    }
+
+    return NULL;
+}
+
+// for backends we can't produce native code for ourselves, SDL_shadercross handles it every launch
+static void shader_cache_compile_uncached(SDL_GPUDevice *gpu, ShaderCacheLoad *load, const u8 *spirv, const usize spirv_size, const SDL_ShaderCross_ShaderStage stage) {
+    const SDL_ShaderCross_SPIRV_Info info = {
+        .bytecode = spirv,
+        .bytecode_size = spirv_size,
+        .entrypoint = "main",
+        .shader_stage = stage,
+    };
+
+    if (stage == SDL_SHADERCROSS_SHADERSTAGE_COMPUTE) {
+        SDL_ShaderCross_ComputePipelineMetadata *metadata = SDL_ShaderCross_ReflectComputeSPIRV(spirv, spirv_size, 0);
+        if (!metadata) return;
+        load->pipeline = SDL_ShaderCross_CompileComputePipelineFromSPIRV(gpu, &info, metadata, 0);
+        SDL_free(metadata);
+    } else {
+        SDL_ShaderCross_GraphicsShaderMetadata *metadata = SDL_ShaderCross_ReflectGraphicsSPIRV(spirv, spirv_size, 0);
+        if (!metadata) return;
+        load->shader = SDL_ShaderCross_CompileGraphicsShaderFromSPIRV(gpu, &info, &metadata->resource_info, 0);
+        SDL_free(metadata);
+    }
+}
+
+static u64 shader_cache_hash(u64 hash, const u8 *data, const usize size) {
+    // https://en.wikipedia.org/wiki/Fowler–Noll–Vo_hash_function#FNV-1a_hash
+    for (usize i = 0; i < size; i++) hash = (hash ^ data[i]) * 0x100000001B3ull;
+    return hash;
+}
+
+static ShaderCacheHeader *shader_cache_compile(const u8 *spirv, const usize spirv_size, const SDL_ShaderCross_ShaderStage stage, usize *entry_size) {
+    const SDL_ShaderCross_SPIRV_Info info = {
+        .bytecode = spirv,
+        .bytecode_size = spirv_size,
+        .entrypoint = "main",
+        .shader_stage = stage,
+    };
+
+    ShaderCacheHeader header = {
+        .magic = SHADER_CACHE_MAGIC,
+        .version = SHADER_CACHE_VERSION,
+        .format = cache_format,
+        .stage = stage,
+    };
+
+    if (stage == SDL_SHADERCROSS_SHADERSTAGE_COMPUTE) {
+        SDL_ShaderCross_ComputePipelineMetadata *metadata = SDL_ShaderCross_ReflectComputeSPIRV(spirv, spirv_size, 0);
+        if (!metadata) return NULL;
+        header.compute = *metadata;
+        SDL_free(metadata);
+    } else {
+        SDL_ShaderCross_GraphicsShaderMetadata *metadata = SDL_ShaderCross_ReflectGraphicsSPIRV(spirv, spirv_size, 0);
+        if (!metadata) return NULL;
+        header.graphics = metadata->resource_info;
+        SDL_free(metadata);
+    }
+
+    void *code = NULL;
+    usize code_size = 0;
+    switch (cache_format) {
+        case SDL_GPU_SHADERFORMAT_SPIRV:
+            code = SDL_malloc(spirv_size);
+            if (code) SDL_memcpy(code, spirv, spirv_size);
+            code_size = spirv_size;
+            SDL_strlcpy(header.entrypoint, "main", sizeof(header.entrypoint));
+            break;
+        case SDL_GPU_SHADERFORMAT_MSL:
+            // SPIRV-Cross renames `main` since it's reserved in MSL
+            code = SDL_ShaderCross_TranspileMSLFromSPIRV(&info);
+            if (code) code_size = SDL_strlen(code);
+            SDL_strlcpy(header.entrypoint, "main0", sizeof(header.entrypoint));
+            break;
+        case SDL_GPU_SHADERFORMAT_DXIL:
+            code = SDL_ShaderCross_CompileDXILFromSPIRV(&info, &code_size);
+            SDL_strlcpy(header.entrypoint, "main", sizeof(header.entrypoint));
+            break;
+        default:
+            break;
+    }
+
+    if (!code) return NULL;
+    header.code_size = code_size;
+    *entry_size = sizeof(ShaderCacheHeader) + code_size;
+    ShaderCacheHeader *entry = SDL_malloc(*entry_size);
+    if (entry) {
+        *entry = header;
+        SDL_memcpy(entry + 1, code, code_size);
+    }
+
+    SDL_free(code);
+    return entry;
+}
+
+static bool shader_cache_valid(const ShaderCacheHeader *entry, const usize entry_size, const SDL_ShaderCross_ShaderStage stage) {
+    return entry
+        && entry_size >= sizeof(ShaderCacheHeader)
+        && entry->magic == SHADER_CACHE_MAGIC
+        && entry->version == SHADER_CACHE_VERSION
+        && entry->format == cache_format
+        && entry->stage == stage
+        && entry->code_size == entry_size - sizeof(ShaderCacheHeader);
+}
+
+static void shader_cache_create(SDL_GPUDevice *gpu, ShaderCacheLoad *load, const ShaderCacheHeader *entry) {
+    const u8 *code = (const u8*) (entry + 1);
+    if (entry->stage == SDL_SHADERCROSS_SHADERSTAGE_COMPUTE) {
+        load->pipeline = SDL_CreateGPUComputePipeline(gpu, &(SDL_GPUComputePipelineCreateInfo) {
+            .code = code,
+            .code_size = entry->code_size,
+            .entrypoint = entry->entrypoint,
+            .format = entry->format,
+            .num_samplers = entry->compute.num_samplers,
+            .num_readonly_storage_textures = entry->compute.num_readonly_storage_textures,
+            .num_readonly_storage_buffers = entry->compute.num_readonly_storage_buffers,
+            .num_readwrite_storage_textures = entry->compute.num_readwrite_storage_textures,
+            .num_readwrite_storage_buffers = entry->compute.num_readwrite_storage_buffers,
+            .num_uniform_buffers = entry->compute.num_uniform_buffers,
+            .threadcount_x = entry->compute.threadcount_x,
+            .threadcount_y = entry->compute.threadcount_y,
+            .threadcount_z = entry->compute.threadcount_z,
+        });
+    } else {
+        load->shader = SDL_CreateGPUShader(gpu, &(SDL_GPUShaderCreateInfo) {
+            .code = code,
+            .code_size = entry->code_size,
+            .entrypoint = entry->entrypoint,
+            .format = entry->format,
+            .stage = entry->stage == SDL_SHADERCROSS_SHADERSTAGE_VERTEX ? SDL_GPU_SHADERSTAGE_VERTEX : SDL_GPU_SHADERSTAGE_FRAGMENT,
+            .num_samplers = entry->graphics.num_samplers,
+            .num_storage_textures = entry->graphics.num_storage_textures,
+            .num_storage_buffers = entry->graphics.num_storage_buffers,
+            .num_uniform_buffers = entry->graphics.num_uniform_buffers,
+        });
+    }
+}
+
+typedef struct {
+    SDL_GPUDevice *gpu;
+    ShaderCacheLoad *loads;
+} ShaderCacheLoadJobs;
+
+static void shader_cache_load_job(void *data, const u32 index) {
+    const ShaderCacheLoadJobs *jobs = data;
+    ShaderCacheLoad *load = &jobs->loads[index];
+
+    SDL_ShaderCross_ShaderStage stage;
+    if (!shader_cache_stage(load->path, &stage)) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "shader_cache_stage() in shader_cache_load(): Shader at path %s must include `.vert`, `.frag` or `.comp` to determine shader type.\n", load->path);
+        return;
+    }
+
+    usize spirv_size;
+    const u8 *spirv = shader_cache_read(load->path, &spirv_size);
+    if (!spirv) {
+        SDL_LogError(SDL_LOG_CATEGORY_APPLICATION, "shader_cache_read() in shader_cache_load(): Couldn't find shader at path %s.\n", load->path);
+        return;
+    }
+
+    u64 key = shader_cache_hash(0xCBF29CE484222325ull, spirv, spirv_size);
+    key = shader_cache_hash(key, (const u8*) &cache_format, sizeof(cache_format));
+    char entry_path[1024 + 32] = { 0 };
+    if (cache_directory[0]) SDL_snprintf(entry_path, sizeof(entry_path), "%s/%016llx.bin", cache_directory, (unsigned long long) key);
+
+    usize entry_size = 0;
+    ShaderCacheHeader *entry = entry_path[0] ? SDL_LoadFile(entry_path, &entry_size) : NULL;
+    if (!shader_cache_valid(entry, entry_size, stage)) {
+        SDL_free(entry);
+        entry = cache_format != SDL_GPU_SHADERFORMAT_INVALID ? shader_cache_compile(spirv, spirv_size, stage, &entry_size) : NULL;
+        if (entry && entry_path[0]) SDL_SaveFile(entry_path, entry, entry_size);
+    }
+
+    if (entry) shader_cache_create(jobs->gpu, load, entry);
+    else shader_cache_compile_uncached(jobs->gpu, load, spirv, spirv_size, stage);
+
+    SDL_free(entry);
+}
+
+bool shader_cache_load(SDL_GPUDevice *gpu, ShaderCacheLoad *loads, const u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        loads[i].shader = NULL;
+        loads[i].pipeline = NULL;
+    }
+
+    shader_cache_parallel(shader_cache_load_job, &(ShaderCacheLoadJobs) { gpu, loads }, count);
+
+    bool loaded = true;
+    for (u32 i = 0; i < count; i++) loaded &= loads[i].shader || loads[i].pipeline;
+    return loaded;
+}
+
+typedef struct {
+    ShaderCacheJob job;
+    void *data;
+    u32 count;
+    SDL_AtomicInt next;
+} ShaderCacheWork;
+
+static int shader_cache_worker(void *data) {
+    ShaderCacheWork *work = data;
+    for (i32 i = SDL_AddAtomicInt(&work->next, 1); i < (i32) work->count; i = SDL_AddAtomicInt(&work->next, 1)) {
+        work->job(work->data, (u32) i);
+    }
+
+    return 0;
+}
+
+void shader_cache_parallel(const ShaderCacheJob job, void *data, const u32 count) {
+    ShaderCacheWork work = { .job = job, .data = data, .count = count };
+    SDL_SetAtomicInt(&work.next, 0);
+
+    SDL_Thread *threads[SHADER_CACHE_MAX_THREADS];
+    const u32 thread_count = SDL_min(SDL_min((u32) SDL_GetNumLogicalCPUCores(), count), SHADER_CACHE_MAX_THREADS);
+    u32 started = 0;
+    for (u32 i = 1; i < thread_count; i++) {
+        threads[started] = SDL_CreateThread(shader_cache_worker, "shader cache", &work);
+        if (threads[started]) started++;
+    }
+
+    // the calling thread works through the jobs too, so nothing is lost if no threads could be started
+    shader_cache_worker(&work);
+    for (u32 i = 0; i < started; i++) SDL_WaitThread(threads[i], NULL);
+}
+
+void shader_cache_free(void) {
+    if (!override_shaders) return;
+    for (u32 i = 0; i < EMBEDDED_SHADER_COUNT; i++) SDL_free((void *) override_shaders[i].code);
+    SDL_free(override_shaders);
+    override_shaders = NULL;
+}
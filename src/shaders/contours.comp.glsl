@@ -0,0 +1,81 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) readonly buffer Grid { vec4 grid[]; };
+layout (std430, set = 0, binding = 1) buffer Segments { vec2 points[]; };
+layout (std430, set = 0, binding = 2) buffer Arguments { uint arguments[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    vec2 grid_origin;
+    uvec2 grid_size;
+    float grid_cell;
+    float level_base;
+    float level_ratio;
+    uint level_count;
+    uint capacity;
+};
+
+#include "field_grid.lib.glsl"
+
+// arguments[0] is the vertex count of the draw, over capacity the slot is handed back
+// so the count only ever covers segments that were written
+void contour_emit(vec2 a, vec2 b) {
+    uint slot = atomicAdd(arguments[0], 2);
+    if (slot + 2 > capacity) {
+        atomicAdd(arguments[0], uint(-2));
+        return;
+    }
+
+    points[slot] = a;
+    points[slot + 1] = b;
+}
+
+// marching squares, one grid cell per invocation for every level
+void main() {
+    uint i = gl_WorkGroupID.y * gl_NumWorkGroups.x * WORKGROUP_SIZE + gl_GlobalInvocationID.x;
+    uint width = grid_size.x - 1;
+    if (i >= width * (grid_size.y - 1)) return;
+    ivec2 cell = ivec2(i % width, i / width);
+
+    // corners counter-clockwise from the bottom left, edge j runs from corner j to corner j + 1
+    const ivec2 corners[4] = ivec2[](ivec2(0, 0), ivec2(1, 0), ivec2(1, 1), ivec2(0, 1));
+    float values[4];
+    vec2 positions[4];
+    for (int j = 0; j < 4; j++) {
+        values[j] = grid_cell_at(cell + corners[j]).z;
+        positions[j] = grid_origin + grid_cell * vec2(cell + corners[j]);
+    }
+
+    float low = min(min(values[0], values[1]), min(values[2], values[3]));
+    float high = max(max(values[0], values[1]), max(values[2], values[3]));
+    float center = 0.25 * (values[0] + values[1] + values[2] + values[3]);
+
+    for (uint k = 0; k < level_count; k++) {
+        float level = level_base * pow(level_ratio, float(k));
+        if (level < low || level >= high) continue;
+
+        vec2 crossings[4];
+        int count = 0;
+        for (int j = 0; j < 4; j++) {
+            int next = (j + 1) % 4;
+            if ((values[j] > level) == (values[next] > level)) continue;
+            float t = (level - values[j]) / (values[next] - values[j]);
+            crossings[count++] = mix(positions[j], positions[next], t);
+        }
+
+        if (count == 2) {
+            contour_emit(crossings[0], crossings[1]);
+        } else if (count == 4) {
+            // saddle, the cell center decides which pair of opposite corners is connected
+            bool joined = (center > level) == (values[0] > level);
+            if (joined) {
+                contour_emit(crossings[0], crossings[1]);
+                contour_emit(crossings[2], crossings[3]);
+            } else {
+                contour_emit(crossings[3], crossings[0]);
+                contour_emit(crossings[1], crossings[2]);
+            }
+        }
+    }
+}
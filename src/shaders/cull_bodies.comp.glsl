@@ -0,0 +1,31 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) readonly buffer Positions { vec2 positions[]; };
+layout (std430, set = 0, binding = 1) readonly buffer PreviousPositions { vec2 previous_positions[]; };
+layout (std430, set = 0, binding = 2) readonly buffer Masses { float masses[]; };
+layout (std430, set = 0, binding = 3) buffer Visible { uint visible[]; };
+layout (std430, set = 0, binding = 4) buffer Arguments { uint arguments[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    vec2 view_min;
+    vec2 view_max;
+    uint body_count;
+    float density;
+    float alpha;
+    uint argument_offset;
+};
+
+float compute_radius(float mass) { return pow(mass / density, 1.0 / 3.0); }
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= body_count) return;
+
+    vec2 position = mix(previous_positions[i], positions[i], alpha);
+    float radius = compute_radius(masses[i]);
+    if (any(lessThan(position + radius, view_min)) || any(greaterThan(position - radius, view_max))) return;
+
+    // arguments[argument_offset + 1] is the instance count of this draw
+    visible[atomicAdd(arguments[argument_offset + 1], 1)] = i;
+}
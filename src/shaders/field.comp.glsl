@@ -1,45 +1,111 @@
 #version 460
 #extension GL_ARB_shading_language_include : enable
 #include "../../include/constants.h"
+#include "workgroup.lib.glsl"
 
 layout (std430, set = 0, binding = 0) buffer FieldLinePositions { vec2 r[][FIELD_LINE_LENGTH]; };
 layout (std430, set = 0, binding = 1) readonly buffer FieldLineIDs { uint line_id[]; };
 layout (std430, set = 0, binding = 2) readonly buffer SimulationPositons { vec2 r_0[]; };
 layout (std430, set = 0, binding = 3) readonly buffer SimulationMasses { float m[]; };
+layout (std430, set = 0, binding = 4) readonly buffer Grid { vec4 grid[]; };
+layout (std430, set = 0, binding = 5) buffer FieldLineLengths { uint vertex_count[]; };
+layout (std430, set = 0, binding = 6) buffer FieldLineDistances { float arc[][FIELD_LINE_LENGTH]; };
+layout (std430, set = 0, binding = 7) buffer FieldLineSteps { float h[]; };
+layout (std430, set = 0, binding = 8) readonly buffer FieldLineSpans { uvec2 span[]; };
 
 layout (std140, set = 2, binding = 0) uniform Constants {
     uint body_count;
     float G;
     float ee;
-    float line_volume;
     float line_step;
+    vec2 grid_origin;
+    uvec2 grid_size;
+    float grid_cell;
+    uint line_total;
 };
 
 layout (std140, set = 2, binding = 1) uniform Frame { uint frame; };
 
-vec2 gravity(vec2 position) {
-    vec2 net_a = vec2(0.0);
-    for (uint i = 0; i < body_count; i++) {
-        vec2 R = r_0[i] - position;
-        float R2 = dot(R, R) + ee * ee;
-        net_a += (G * m[i] / R2) * normalize(R);
+#include "field_grid.lib.glsl"
+
+// lines only ever run inside the grid, which covers the viewport and a margin around it
+vec2 field(vec2 position) {
+    return grid_sample(position).xy;
+}
+
+// lines end once they leave the grid or fall into a mass other than their own. every grid cell knows the body
+// nearest to it, so only the bodies nearest the corners of the cell the line is in are checked
+bool line_ended(vec2 position, uint self) {
+    if (!grid_contains(position)) return true;
+
+    float radius = max(ee, line_step);
+    ivec2 c = ivec2(floor((position - grid_origin) / grid_cell));
+    ivec2 corners[4] = ivec2[](c, c + ivec2(1, 0), c + ivec2(0, 1), c + ivec2(1, 1));
+    for (uint k = 0; k < 4; k++) {
+        float nearest = grid_cell_at(corners[k]).w;
+        if (nearest < 0.0) continue;
+        uint body = uint(nearest);
+        vec2 R = r_0[body] - position;
+        if (body != self && body < body_count && dot(R, R) < radius * radius) return true;
     }
 
-    return net_a;
+    return false;
+}
+
+// field lines run against the field, one unit of arc length per unit of parameter
+vec2 direction(vec2 position) {
+    return -normalize(field(position));
+}
+
+// Bogacki-Shampine 3(2): the difference between the embedded solutions estimates the local error
+vec2 line_step_rk23(vec2 y, float ds, out float error) {
+    vec2 k_1 = direction(y);
+    vec2 k_2 = direction(y + 0.5 * ds * k_1);
+    vec2 k_3 = direction(y + 0.75 * ds * k_2);
+    vec2 y_3 = y + ds * (2.0 / 9.0 * k_1 + 1.0 / 3.0 * k_2 + 4.0 / 9.0 * k_3);
+    vec2 k_4 = direction(y_3);
+    vec2 y_2 = y + ds * (7.0 / 24.0 * k_1 + 0.25 * k_2 + 1.0 / 3.0 * k_3 + 0.125 * k_4);
+    error = length(y_3 - y_2);
+    return y_3;
 }
 
-layout (local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
 void main() {
     uint i = gl_GlobalInvocationID.x;
+    if (i >= line_total) return;
+    if (line_id[i] >= body_count) { // left over from the budget
+        if (frame == 0) vertex_count[i] = 0;
+        return;
+    }
+
+    // vertex_count[i] only keeps up with frame while the line is alive, an ended line never catches up again
     if (frame == 0) {
         uint body = line_id[i];
-        uint line_count = int(m[body] / line_volume);
-        float theta = TAU / line_count * i;
+        float theta = TAU / float(span[body].y) * float(i - span[body].x);
         r[i][0] = r_0[body] + vec2(cos(theta), sin(theta));
-    } else {
+        arc[i][0] = 0.0;
+        h[i] = line_step;
+        vertex_count[i] = 1;
+    } else if (vertex_count[i] == frame) {
         vec2 y = r[i][frame - 1];
-        vec2 k_1 = normalize(gravity(y));
-        vec2 k_2 = normalize(gravity(y - 0.5 * line_step * k_1));
-        r[i][frame] = y - line_step * k_2;
+        float traveled = arc[i][frame - 1];
+        if (traveled >= FIELD_LINE_EXTENT * line_step || line_ended(y, line_id[i])) return;
+
+        // the error is measured in grid cells, so lines are exactly as accurate as they can be seen to be
+        float tolerance = FIELD_LINE_TOLERANCE * grid_cell;
+        float step_min = FIELD_LINE_STEP_MIN * line_step;
+        float step_max = FIELD_LINE_STEP_MAX * line_step;
+        float ds = clamp(h[i], step_min, step_max);
+        float error;
+        vec2 next = line_step_rk23(y, ds, error);
+        for (uint attempt = 0; attempt < 4 && error > tolerance && ds > step_min; attempt++) {
+            ds = max(ds * max(0.9 * pow(tolerance / error, 1.0 / 3.0), 0.2), step_min);
+            next = line_step_rk23(y, ds, error);
+        }
+
+        float growth = error > 0.0 ? 0.9 * pow(tolerance / error, 1.0 / 3.0) : 4.0;
+        h[i] = clamp(ds * clamp(growth, 0.2, 4.0), step_min, step_max);
+        r[i][frame] = next;
+        arc[i][frame] = traveled + ds;
+        vertex_count[i] = frame + 1;
     }
 }
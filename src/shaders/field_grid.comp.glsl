@@ -0,0 +1,54 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) buffer Grid { vec4 grid[]; };
+layout (std430, set = 0, binding = 1) readonly buffer SimulationPositons { vec2 r_0[]; };
+layout (std430, set = 0, binding = 2) readonly buffer SimulationMasses { float m[]; };
+layout (std430, set = 0, binding = 3) readonly buffer State { uint moved; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    vec2 grid_origin;
+    uvec2 grid_size;
+    float grid_cell;
+    uint body_count;
+    float G;
+    float ee;
+    uint force;
+};
+
+shared vec3 tile[WORKGROUP_SIZE];
+
+// every invocation takes part in loading the tiles, so cells past the end only skip the final write
+void main() {
+    if (force == 0 && moved == 0) return;
+    uint i = gl_WorkGroupID.y * gl_NumWorkGroups.x * WORKGROUP_SIZE + gl_GlobalInvocationID.x;
+    vec2 position = grid_origin + grid_cell * vec2(i % grid_size.x, i / grid_size.x);
+
+    vec2 acceleration = vec2(0.0);
+    float potential = 0.0;
+    float nearest = -1.0;
+    float nearest_distance = 1e30;
+    for (uint start = 0; start < body_count; start += WORKGROUP_SIZE) {
+        uint body = start + gl_LocalInvocationID.x;
+        tile[gl_LocalInvocationID.x] = body < body_count ? vec3(r_0[body], m[body]) : vec3(0.0);
+        barrier();
+
+        uint tile_count = min(uint(WORKGROUP_SIZE), body_count - start);
+        for (uint j = 0; j < tile_count; j++) {
+            vec2 R = tile[j].xy - position;
+            float R2 = dot(R, R) + ee * ee;
+            float distance = length(R);
+            if (distance > 0.0) acceleration += (G * tile[j].z / R2) * (R / distance);
+            potential += G * tile[j].z / sqrt(R2);
+            if (distance < nearest_distance) {
+                nearest_distance = distance;
+                nearest = float(start + j);
+            }
+        }
+
+        barrier();
+    }
+
+    if (i < grid_size.x * grid_size.y) grid[i] = vec4(acceleration, potential, nearest);
+}
@@ -0,0 +1,25 @@
+// bilinear lookups into the field grid, the including shader declares `vec4 grid[]` (acceleration, potential,
+// nearest body, which is only meaningful read straight from a cell)
+// and the grid_origin, grid_size and grid_cell uniforms that field_grid.comp was run with
+
+vec4 grid_cell_at(ivec2 cell) {
+    cell = clamp(cell, ivec2(0), ivec2(grid_size) - 1);
+    return grid[cell.y * grid_size.x + cell.x];
+}
+
+bool grid_contains(vec2 position) {
+    vec2 cell = (position - grid_origin) / grid_cell;
+    return all(greaterThanEqual(cell, vec2(0.0))) && all(lessThanEqual(cell, vec2(grid_size - 1)));
+}
+
+vec4 grid_sample(vec2 position) {
+    vec2 cell = (position - grid_origin) / grid_cell;
+    vec2 base = floor(cell);
+    vec2 t = cell - base;
+    ivec2 c = ivec2(base);
+    return mix(
+        mix(grid_cell_at(c), grid_cell_at(c + ivec2(1, 0)), t.x),
+        mix(grid_cell_at(c + ivec2(0, 1)), grid_cell_at(c + ivec2(1, 1)), t.x),
+        t.y
+    );
+}
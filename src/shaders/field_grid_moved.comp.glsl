@@ -0,0 +1,27 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) buffer Snapshot { vec2 snapshot[]; };
+layout (std430, set = 0, binding = 1) readonly buffer SimulationPositons { vec2 r_0[]; };
+layout (std430, set = 0, binding = 2) buffer State { uint moved; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    uint body_count;
+    float threshold;
+    uint mode;
+    uint force;
+};
+
+// mode 0 flags the grid as stale once any body is further than the threshold from where it was sampled,
+// mode 1 runs after the grid and records the positions it was sampled with
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= body_count) return;
+
+    if (mode == 0) {
+        if (distance(r_0[i], snapshot[i]) > threshold) moved = 1;
+    } else if (force != 0 || moved != 0) {
+        snapshot[i] = r_0[i];
+    }
+}
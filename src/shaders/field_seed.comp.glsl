@@ -0,0 +1,69 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../../include/constants.h"
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) readonly buffer Masses { float m[]; };
+layout (std430, set = 0, binding = 1) buffer FieldLineIDs { uint line_id[]; };
+layout (std430, set = 0, binding = 2) buffer FieldLineSpans { uvec2 span[]; };
+layout (std430, set = 0, binding = 3) readonly buffer FieldBodies { uint bodies[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    uint body_count;
+    uint line_budget;
+    uint count;
+};
+
+shared float partial[WORKGROUP_SIZE];
+shared uint scan[WORKGROUP_SIZE];
+
+// only the selected bodies get lines, one added since the simulation's last step has no mass yet
+float mass(uint k) {
+    uint i = bodies[k];
+    return i < body_count ? max(m[i], 0.0) : 0.0;
+}
+
+// a single workgroup hands out the line budget in proportion to mass: the total mass is reduced first,
+// then the selected bodies are scanned a workgroup at a time so every one knows where its lines start
+void main() {
+    uint t = gl_LocalInvocationID.x;
+
+    float sum = 0.0;
+    for (uint k = t; k < count; k += WORKGROUP_SIZE) sum += mass(k);
+    partial[t] = sum;
+    barrier();
+    for (uint stride = WORKGROUP_SIZE / 2; stride > 0; stride /= 2) {
+        if (t < stride) partial[t] += partial[t + stride];
+        barrier();
+    }
+    float total = partial[0];
+
+    uint carry = 0;
+    for (uint base = 0; base < count; base += WORKGROUP_SIZE) {
+        uint k = base + t;
+        uint lines = (k < count && total > 0.0) ? uint(float(line_budget) * mass(k) / total) : 0;
+        scan[t] = lines;
+        barrier();
+        for (uint offset = 1; offset < WORKGROUP_SIZE; offset *= 2) {
+            uint previous = t >= offset ? scan[t - offset] : 0;
+            barrier();
+            scan[t] += previous;
+            barrier();
+        }
+
+        // rounding can't be trusted to keep the sum under budget, so the tail is clipped
+        uint start = min(carry + scan[t] - lines, line_budget);
+        lines = min(lines, line_budget - start);
+        if (k < count) {
+            uint i = bodies[k];
+            span[i] = uvec2(start, lines);
+            for (uint n = 0; n < lines; n++) line_id[start + n] = i;
+        }
+
+        carry += scan[WORKGROUP_SIZE - 1];
+        barrier();
+    }
+
+    // whatever rounding left over belongs to no body and is never traced
+    for (uint i = min(carry, line_budget) + t; i < line_budget; i += WORKGROUP_SIZE) line_id[i] = 0xFFFFFFFFu;
+}
@@ -12,6 +12,8 @@ layout (std430, set = 0, binding = 0) readonly buffer Positions { vec2 positions
 layout (std430, set = 0, binding = 1) readonly buffer Colors { vec4 colors[]; };
 layout (std430, set = 0, binding = 2) readonly buffer Masses { float masses[]; };
 layout (std430, set = 0, binding = 3) readonly buffer Movables { float movable[]; };
+layout (std430, set = 0, binding = 4) readonly buffer PreviousPositions { vec2 previous_positions[]; };
+layout (std430, set = 0, binding = 5) readonly buffer Visible { uint visible[]; };
 
 layout (std140, set = 1, binding = 0) uniform Camera {
     mat4 orthographic;
@@ -22,16 +24,20 @@ layout (std140, set = 1, binding = 1) uniform Constants {
     float density;
     float movable_outline;
     float static_outline;
+    uint _target;
+    vec3 _padding;
+    float alpha;
 };
 
 float compute_radius(float mass) { return pow(mass / density, 1.0 / 3.0); }
 void main() {
-    frag.color = colors[gl_InstanceIndex];
+    uint body = visible[gl_InstanceIndex];
+    frag.color = colors[body];
     frag.position.x = 2.0 * floor(gl_VertexIndex / 2.0) - 1.0;
     frag.position.y = 2.0 * mod(gl_VertexIndex, 2.0) - 1.0;
-    frag.outline = movable[gl_InstanceIndex] == 1.0 ? movable_outline : static_outline;
+    frag.outline = movable[body] == 1.0 ? movable_outline : static_outline;
 
-    float radius = compute_radius(masses[gl_InstanceIndex]);
-    vec2 position = positions[gl_InstanceIndex];
+    float radius = compute_radius(masses[body]);
+    vec2 position = mix(previous_positions[body], positions[body], alpha);
     gl_Position = orthographic * view * vec4(radius * frag.position + position, 0.0, 1.0);
 }
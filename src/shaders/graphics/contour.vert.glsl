@@ -0,0 +1,17 @@
+#version 460
+
+layout (location = 0) out vec4 out_color;
+
+layout (std430, set = 0, binding = 0) readonly buffer Segments { vec2 points[]; };
+
+layout (std140, set = 1, binding = 0) uniform Camera {
+    mat4 orthographic;
+    mat4 view;
+};
+
+layout (std140, set = 1, binding = 3) uniform Contour { vec4 color; };
+
+void main() {
+    gl_Position = orthographic * view * vec4(points[gl_VertexIndex], 0.0, 1.0);
+    out_color = color;
+}
@@ -7,6 +7,9 @@ layout (location = 0) out vec4 out_color;
 layout (std430, set = 0, binding = 0) readonly buffer Positions { vec2 positions[][FIELD_LINE_LENGTH]; };
 layout (std430, set = 0, binding = 1) readonly buffer LineIDs { uint id[]; };
 layout (std430, set = 0, binding = 2) readonly buffer Colors { vec4 colors[]; };
+layout (std430, set = 0, binding = 3) readonly buffer Segments { uint segments[]; };
+layout (std430, set = 0, binding = 4) readonly buffer Distances { float distances[][FIELD_LINE_LENGTH]; };
+layout (std430, set = 0, binding = 5) readonly buffer VertexCounts { uint vertex_counts[]; };
 
 layout (std140, set = 1, binding = 0) uniform Camera {
     mat4 orthographic;
@@ -18,10 +21,20 @@ layout (std140, set = 1, binding = 1) uniform Constants {
     float brightness;
 };
 
+layout (std140, set = 1, binding = 2) uniform Extent { float extent; };
+
+// the arc length the line actually reached, so its last vertex is the one that fades out completely
+float line_reach(uint line) {
+    uint last = clamp(vertex_counts[line], 1u, uint(FIELD_LINE_LENGTH)) - 1u;
+    return max(min(extent, distances[line][last]), 1e-6);
+}
+
 void main() {
-    vec2 position = positions[gl_InstanceIndex][gl_VertexIndex];
+    uint line = segments[gl_VertexIndex] / FIELD_LINE_LENGTH;
+    uint vertex = segments[gl_VertexIndex] % FIELD_LINE_LENGTH;
+    vec2 position = positions[line][vertex];
     gl_Position = orthographic * view * vec4(position, 0.0, 1.0);
-    float alpha = (brightness / 2.0) * (1.0 - float(gl_VertexIndex) / float(FIELD_LINE_LENGTH));
-    out_color = vec4(colors[id[gl_InstanceIndex]].rgb, alpha);
+    float alpha = (brightness / 2.0) * (1.0 - distances[line][vertex] / line_reach(line));
+    out_color = vec4(colors[id[line]].rgb, alpha);
 }
 
@@ -1,19 +1,47 @@
 #version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../../../include/constants.h"
 
 layout (location = 0) in vec2 position;
 layout (location = 0) out vec4 color;
 
-layout (std430, set = 2, binding = 0) readonly buffer Positions { vec2 r[]; };
-layout (std430, set = 2, binding = 1) readonly buffer Masses { float m[]; };
+layout (std430, set = 2, binding = 0) readonly buffer Grid { vec4 grid[]; };
 
-layout (std140, set = 3, binding = 0) uniform Constants { uint body_count; };
+layout (std140, set = 3, binding = 0) uniform Constants {
+    vec2 grid_origin;
+    uvec2 grid_size;
+    float grid_cell;
+    float G;
+};
 
-void main() {
-    float potential = 0.0;
-    for (uint i = 0; i < body_count; i++) {
-        float R = length(r[i] - position);
-        potential += 0.2 * m[i] / R;
+#include "../field_grid.lib.glsl"
+
+// the grid is coarser than the screen, so each of the four surrounding cells extrapolates along its own gradient
+// (the stored acceleration) and cells that disagree with the bilinear estimate, like those across a body, count less
+float potential_upsample(vec2 position) {
+    vec2 cell = (position - grid_origin) / grid_cell;
+    ivec2 base = ivec2(floor(cell));
+    vec2 t = cell - vec2(base);
+    float estimate = grid_sample(position).z;
+
+    float total = 0.0;
+    float weights = 0.0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        vec4 node_value = grid_cell_at(base + offset);
+        vec2 bilinear = mix(1.0 - t, t, vec2(offset));
+        float similarity = (node_value.z - estimate) / (POTENTIAL_EDGE_SIGMA * max(estimate, 1e-6));
+        float weight = bilinear.x * bilinear.y * exp(-similarity * similarity);
+
+        vec2 node = grid_origin + grid_cell * vec2(base + offset);
+        total += weight * max(node_value.z + dot(node_value.xy, position - node), 0.0);
+        weights += weight;
     }
 
+    return weights > 0.0 ? total / weights : estimate;
+}
+
+void main() {
+    float potential = 0.2 * potential_upsample(position) / G;
     color = vec4(potential, 0.0, 0.0, 0.5);
 }
@@ -0,0 +1,23 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../../../include/constants.h"
+
+layout (location = 0) in vec2 _position;
+layout (location = 0) out vec4 color;
+
+layout (std430, set = 2, binding = 0) readonly buffer Splat { uint splat[]; };
+
+layout (std140, set = 3, binding = 0) uniform Constants {
+    uint width;
+    float exposure;
+};
+
+// exponential tone mapping, dense clusters saturate instead of clipping
+void main() {
+    uint index = 4 * (uint(gl_FragCoord.y) * width + uint(gl_FragCoord.x));
+    float mass = float(splat[index]);
+    if (mass == 0.0) discard;
+
+    vec3 tint = vec3(splat[index + 1], splat[index + 2], splat[index + 3]) / mass;
+    color = vec4(tint, 1.0 - exp(-exposure * mass / SPLAT_FIXED_POINT));
+}
@@ -1,11 +1,17 @@
 #version 460
 #extension GL_ARB_shading_language_include : enable
 #include "../../../include/constants.h"
+#include "../trail.lib.glsl"
 
 layout (location = 0) out vec4 out_color;
 
-layout (std430, set = 0, binding = 0) readonly buffer Positions { vec2 positions[][TRAIL_LENGTH]; };
+layout (std430, set = 0, binding = 0) readonly buffer Trails { uint trails[][TRAIL_LENGTH]; };
 layout (std430, set = 0, binding = 1) readonly buffer Colors { vec4 colors[]; };
+layout (std430, set = 0, binding = 2) readonly buffer Segments { uint segments[]; };
+layout (std430, set = 0, binding = 3) readonly buffer Bodies { uint bodies[]; };
+layout (std430, set = 0, binding = 4) readonly buffer TrailAnchors { TrailAnchor anchors[]; };
+layout (std430, set = 0, binding = 5) readonly buffer Positions { vec2 positions[]; };
+layout (std430, set = 0, binding = 6) readonly buffer PreviousPositions { vec2 previous_positions[]; };
 
 layout (std140, set = 1, binding = 0) uniform Camera {
     mat4 orthographic;
@@ -14,21 +20,30 @@ layout (std140, set = 1, binding = 0) uniform Camera {
 
 layout (std140, set = 1, binding = 1) uniform Constants {
     vec3 _padding;
-    uint target;
+    uint _target;
     float brightness;
-    float padding;
+    uint body_count;
     uint frame;
+    float alpha;
 };
 
+layout (std140, set = 1, binding = 3) uniform Trail { uint target; }; // the followed body's trail
+
+// counted back from the newest sample, which is drawn where the body is now rather than where it was last sampled
+vec2 trail_point(uint trail, uint vertex) {
+    uint body = bodies[trail];
+    if (vertex == 0 && body < body_count) return mix(previous_positions[body], positions[body], alpha);
+    return trail_decode(anchors[trail], trails[trail][(frame - vertex) % TRAIL_LENGTH]);
+}
+
 void main() {
-    vec2 position = positions[gl_InstanceIndex][(frame - gl_VertexIndex) % TRAIL_LENGTH];
-    if (target != uint(-1)) {
-        position += positions[target][frame]
-            - positions[target][(frame - gl_VertexIndex) % TRAIL_LENGTH];
-    }
+    uint trail = segments[gl_VertexIndex] / TRAIL_LENGTH;
+    uint vertex = segments[gl_VertexIndex] % TRAIL_LENGTH;
+    vec2 position = trail_point(trail, vertex);
+    if (target != uint(-1)) position += trail_point(target, 0) - trail_point(target, vertex);
 
     gl_Position = orthographic * view * vec4(position, 0.0, 1.0);
 
-    float alpha = brightness * (1.0 - float(gl_VertexIndex) / float(TRAIL_LENGTH));
-    out_color = vec4(colors[gl_InstanceIndex].rgb, alpha);
+    float alpha = brightness * (1.0 - float(vertex) / float(TRAIL_LENGTH));
+    out_color = vec4(colors[bodies[trail]].rgb, alpha);
 }
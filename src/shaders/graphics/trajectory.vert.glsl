@@ -6,6 +6,11 @@ layout (location = 0) out vec4 out_color;
 
 layout (std430, set = 0, binding = 0) readonly buffer Positions { vec2 positions[][PREDICTION_LENGTH]; };
 layout (std430, set = 0, binding = 1) readonly buffer Colors { vec4 colors[]; };
+layout (std430, set = 0, binding = 2) readonly buffer PreviousPositions { vec2 previous_positions[]; };
+layout (std430, set = 0, binding = 3) readonly buffer Segments { uint segments[]; };
+layout (std430, set = 0, binding = 4) readonly buffer Times { float times[][PREDICTION_LENGTH]; };
+layout (std430, set = 0, binding = 5) readonly buffer VertexCounts { uint vertex_counts[]; };
+layout (std430, set = 0, binding = 6) readonly buffer Bodies { uint bodies[]; };
 
 layout (std140, set = 1, binding = 0) uniform Camera {
     mat4 orthographic;
@@ -14,22 +19,44 @@ layout (std140, set = 1, binding = 0) uniform Camera {
 
 layout (std140, set = 1, binding = 1) uniform Constants {
     vec3 _padding;
-    uint target;
+    uint _target;
     float brightness;
     uint body_count;
+    uint _frame;
+    float alpha;
 };
 
 layout (std140, set = 1, binding = 2) uniform Ghost { vec4 ghost; };
+layout (std140, set = 1, binding = 3) uniform Trajectory {
+    float horizon;
+    uint target; // the followed body's slot
+};
+
+// predictions start from the latest step, pull their first vertex back to where the body is drawn. lines are
+// indexed by slot, the body in the ghost's slot is past the last one
+vec2 trajectory_position(uint line, uint vertex) {
+    uint body = bodies[line];
+    if (vertex == 0 && body < body_count) return mix(previous_positions[body], positions[line][0], alpha);
+    return positions[line][vertex];
+}
+
+vec2 line_vertex(uint line, uint n) { return trajectory_position(line, n); }
+float line_time(uint line, uint n) { return times[line][n]; }
+uint line_vertex_count(uint line) { return vertex_counts[line]; }
+#include "../timed_line.lib.glsl"
 
 void main() {
-    vec2 position = positions[gl_InstanceIndex][gl_VertexIndex];
+    uint line = segments[gl_VertexIndex] / PREDICTION_LENGTH;
+    uint vertex = segments[gl_VertexIndex] % PREDICTION_LENGTH;
+    vec2 position = trajectory_position(line, vertex);
     if (target != uint(-1)) {
-        position += positions[target][0] - positions[target][gl_VertexIndex];
+        position += trajectory_position(target, 0) - line_at_time(target, times[line][vertex]);
     }
 
     gl_Position = orthographic * view * vec4(position, 0.0, 1.0);
 
-    vec4 color = (gl_InstanceIndex == body_count) ? ghost : colors[gl_InstanceIndex];
-    float alpha = (brightness / 2.0) * (1.0 - float(gl_VertexIndex) / float(PREDICTION_LENGTH));
+    uint body = bodies[line];
+    vec4 color = (body >= body_count) ? ghost : colors[body];
+    float alpha = (brightness / 2.0) * (1.0 - times[line][vertex] / horizon);
     out_color = vec4(color.rgb, alpha);
 }
@@ -0,0 +1,186 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../../include/constants.h"
+#include "workgroup.lib.glsl"
+#include "trail.lib.glsl"
+
+layout (std430, set = 0, binding = 0) readonly buffer Points { vec2 points[]; };
+layout (std430, set = 0, binding = 1) buffer Segments { uint segments[]; };
+layout (std430, set = 0, binding = 2) buffer Arguments { uint arguments[]; };
+layout (std430, set = 0, binding = 3) readonly buffer VertexCounts { uint vertex_counts[]; };
+layout (std430, set = 0, binding = 4) readonly buffer Times { float times[]; };
+layout (std430, set = 0, binding = 5) readonly buffer QuantizedPoints { uint quantized_points[]; };
+layout (std430, set = 0, binding = 6) readonly buffer TrailAnchors { TrailAnchor anchors[]; };
+layout (std430, set = 0, binding = 7) buffer Demand { uint demand[]; }; // segment vertices wanted per draw, fitting or not
+layout (std430, set = 0, binding = 8) readonly buffer LineSlots { uint line_slots[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    vec2 view_min;
+    vec2 view_max;
+    uint line_count;
+    uint line_length;
+    uint target;
+    uint anchor;
+    uint ring;
+    float tolerance;
+    uint argument_offset;
+    uint variable;
+    uint timed;
+    uint quantized; // points are packed trail offsets, decoded against each line's trail anchor
+    uint capacity; // segment vertices the segments buffer can hold, lines past it are left out until it grows
+    uint slotted; // only the lines listed in line_slots are culled, line_count of them
+};
+
+#define LINE_WORDS (LOD_LINE_LENGTH_MAX / 32)
+
+shared vec4 bounds[WORKGROUP_SIZE];
+shared vec2 corners[LOD_LINE_LENGTH_MAX / 2]; // the even vertices, every block starts and ends on one
+shared uint flat_blocks[LINE_WORDS]; // a bit per block of the level being checked
+shared uint dropped[LINE_WORDS]; // a bit per vertex inside some flat block
+shared uint ranks[LINE_WORDS]; // how many vertices are kept before each word
+shared uint line_base;
+
+// lines that can end early only draw the vertices they actually reached
+uint line_size(uint line) {
+    return variable != 0 ? min(vertex_counts[line], line_length) : line_length;
+}
+
+vec2 line_vertex(uint line, uint n) {
+    uint index = line * line_length + n;
+    return quantized != 0 ? trail_decode(anchors[line], quantized_points[index]) : points[index];
+}
+
+float line_time(uint line, uint n) { return times[line * line_length + n]; }
+uint line_vertex_count(uint line) { return line_size(line); }
+#include "timed_line.lib.glsl"
+
+// vertex n of a line in drawing order, ring buffers are drawn backwards from the anchor
+uint line_index(uint n) {
+    return ring != 0 ? (anchor + line_length - n) % line_length : n;
+}
+
+// lines drawn relative to a target are offset per vertex the same way the vertex shaders do it, lines whose
+// vertices were kept at uneven times are matched up with the target by time rather than by vertex
+vec2 line_point(uint line, uint n) {
+    uint k = line_index(n);
+    vec2 point = line_vertex(line, k);
+    if (target != uint(-1)) {
+        vec2 target_point = timed != 0 ? line_at_time(target, line_time(line, k)) : line_vertex(target, k);
+        point += line_vertex(target, anchor) - target_point;
+    }
+
+    return point;
+}
+
+// how far a vertex strays from the straight segment between two even vertices
+float line_deviation(vec2 point, uint start, uint end) {
+    vec2 a = corners[start / 2];
+    vec2 ab = corners[end / 2] - a;
+    float t = clamp(dot(point - a, ab) / max(dot(ab, ab), 1e-30), 0.0, 1.0);
+    return length(point - a - t * ab);
+}
+
+uint kept_bits(uint word, uint size) {
+    uint bits = ~dropped[word];
+    uint remaining = size - 32 * word;
+    return remaining >= 32 ? bits : bits & ((1u << remaining) - 1u);
+}
+
+// the last vertex is always kept, so this always finds one
+uint next_kept(uint from, uint size) {
+    uint word = from / 32;
+    uint bits = kept_bits(word, size) & (~0u << (from % 32));
+    while (bits == 0u) bits = kept_bits(++word, size);
+    return 32 * word + uint(findLSB(bits));
+}
+
+// one workgroup per line, its vertices shared out over the lanes. lines are split into aligned blocks of 2, 4, 8...
+// vertices, a block is flat when every vertex inside it is within tolerance of the segment between its ends, and a
+// vertex is dropped once it's inside any flat block. the kept vertices are the ends of the largest flat blocks, so
+// the drawn line never strays more than the tolerance from the real one. kept vertices are ranked with a prefix sum
+// over their bit words and written out as (line, vertex) pairs for a line list
+void main() {
+    uint index = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint lane = gl_LocalInvocationID.x;
+    if (index >= line_count) return;
+    uint line = slotted != 0 ? line_slots[index] : index;
+    uint size = line_size(line);
+    if (size < 2) return;
+
+    // vertex order doesn't matter for the bounds so ring buffers don't need unwrapping
+    vec2 low = vec2(1e30);
+    vec2 high = vec2(-1e30);
+    for (uint n = lane; n < size; n += WORKGROUP_SIZE) {
+        vec2 point = line_point(line, n);
+        if (n % 2 == 0) corners[n / 2] = point;
+        low = min(low, point);
+        high = max(high, point);
+    }
+
+    bounds[lane] = vec4(low, high);
+    barrier();
+    for (uint half_width = WORKGROUP_SIZE / 2; half_width > 0; half_width /= 2) {
+        if (lane < half_width) {
+            bounds[lane] = vec4(min(bounds[lane].xy, bounds[lane + half_width].xy), max(bounds[lane].zw, bounds[lane + half_width].zw));
+        }
+        barrier();
+    }
+
+    vec4 reach = bounds[0];
+    if (any(lessThan(reach.zw, view_min)) || any(greaterThan(reach.xy, view_max))) return;
+
+    uint words = (size + 31) / 32;
+    for (uint w = lane; w < words; w += WORKGROUP_SIZE) dropped[w] = 0u;
+
+    // blocks running past the last vertex are never flat, so it's always kept
+    for (uint level = 1; (1u << level) < size; level++) {
+        uint width = 1u << level;
+        uint blocks = (size + width - 2) / width;
+        for (uint w = lane; w < (blocks + 31) / 32; w += WORKGROUP_SIZE) flat_blocks[w] = ~0u;
+        barrier();
+
+        for (uint n = lane; n < size; n += WORKGROUP_SIZE) {
+            uint block = n >> level;
+            uint start = block << level;
+            if (block >= blocks || n == start) continue;
+            uint end = start + width;
+            if (end >= size || line_deviation(line_point(line, n), start, end) > tolerance) {
+                atomicAnd(flat_blocks[block / 32], ~(1u << (block % 32)));
+            }
+        }
+        barrier();
+
+        for (uint n = lane; n < size; n += WORKGROUP_SIZE) {
+            uint block = n >> level;
+            if (block >= blocks || n == (block << level)) continue;
+            if ((flat_blocks[block / 32] & (1u << (block % 32))) != 0u) atomicOr(dropped[n / 32], 1u << (n % 32));
+        }
+        barrier();
+    }
+
+    // every draw asks for room through its demand, which only ever grows, so the lines that fit are always the
+    // first ones to ask and arguments[argument_offset], the vertex count of this draw, covers exactly them
+    if (lane == 0) {
+        uint kept = 0;
+        for (uint w = 0; w < words; w++) {
+            ranks[w] = kept;
+            kept += uint(bitCount(kept_bits(w, size)));
+        }
+
+        uint count = 2 * (kept - 1);
+        uint base = atomicAdd(demand[argument_offset / 4], count);
+        bool fits = base + count <= capacity;
+        if (fits) atomicAdd(arguments[argument_offset], count);
+        line_base = fits ? base : ~0u;
+    }
+    barrier();
+    if (line_base == ~0u) return;
+
+    for (uint n = lane; n + 1 < size; n += WORKGROUP_SIZE) {
+        uint bits = kept_bits(n / 32, size);
+        if ((bits & (1u << (n % 32))) == 0u) continue;
+        uint rank = ranks[n / 32] + uint(bitCount(bits & ((1u << (n % 32)) - 1u)));
+        segments[line_base + 2 * rank] = line * line_length + n;
+        segments[line_base + 2 * rank + 1] = line * line_length + next_kept(n + 1, size);
+    }
+}
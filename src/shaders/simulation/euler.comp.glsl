@@ -1,34 +1,36 @@
 #version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../workgroup.lib.glsl"
 
 layout (std430, set = 0, binding = 0) buffer Positions { vec2 r[]; };
 layout (std430, set = 0, binding = 1) buffer StartingPositions { vec2 r_0[]; };
 layout (std430, set = 0, binding = 2) buffer Velocities { vec2 v[]; };
 layout (std430, set = 0, binding = 3) readonly buffer Masses { float m[]; };
-layout (std430, set = 0, binding = 4) readonly buffer Movable { float mov[]; };
+layout (std430, set = 0, binding = 4) readonly buffer MovableIndices { uint movable_index[]; };
+layout (std430, set = 0, binding = 5) readonly buffer StaticPositions { vec2 static_r[]; };
+layout (std430, set = 0, binding = 6) readonly buffer StaticMasses { float static_m[]; };
+layout (std430, set = 0, binding = 7) readonly buffer StaticField { vec4 grid[]; };
 
 layout (std140, set = 2, binding = 0) uniform Constants {
-    uint body_count;
+    vec2 grid_origin;
+    uvec2 grid_size;
+    vec2 static_center;
+    float grid_cell;
+    uint movable_count;
+    uint static_count;
     float G;
     float ee;
     float dt;
+    float static_mass;
+    uint static_cached;
 };
 
-uint when_neq(uint a, uint b) { return uint(a != b); }
-vec2 gravity(uint self) {
-    vec2 net_a = vec2(0.0);
-    for (uint i = 0; i < body_count; i++) {
-        vec2 R = r_0[i] - r_0[self];
-        float R2 = dot(R, R) + ee * ee;
-        net_a += (G * m[i] / R2) * normalize(R) * when_neq(i, self);
-    }
-
-    return net_a;
-}
+#include "gravity.lib.glsl"
 
 // https://en.wikipedia.org/wiki/Semi-implicit_Euler_method#The_method
-layout (local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
 void main() {
-    uint i = gl_GlobalInvocationID.x;
-    v[i] += gravity(i) * dt * mov[i];
-    r[i] = r_0[i] + v[i] * dt * mov[i];
+    if (gl_GlobalInvocationID.x >= movable_count) return;
+    uint i = movable_index[gl_GlobalInvocationID.x];
+    v[i] += gravity(i, r_0[i]) * dt;
+    r[i] = r_0[i] + v[i] * dt;
 }
@@ -0,0 +1,37 @@
+// gravity felt by a movable body, shared by the integrators. the including shader declares r_0, m, movable_index,
+// static_r, static_m and grid, and the Constants block the simulation pushes
+
+#include "../field_grid.lib.glsl"
+
+// static bodies never move, so once there are enough of them their pull is read from a grid sampled when one was
+// added instead of being summed again on every step. past the grid's edge they're close enough to a point mass
+vec2 static_gravity(vec2 r_self) {
+    if (static_cached == 0) {
+        vec2 net_a = vec2(0.0);
+        for (uint i = 0; i < static_count; i++) {
+            vec2 R = static_r[i] - r_self;
+            float R2 = dot(R, R) + ee * ee;
+            net_a += (G * static_m[i] / R2) * normalize(R);
+        }
+
+        return net_a;
+    }
+
+    if (grid_contains(r_self)) return grid_sample(r_self).xy;
+    vec2 R = static_center - r_self;
+    return (G * static_mass / (dot(R, R) + ee * ee)) * normalize(R);
+}
+
+// other movable bodies are held at their starting positions, their new ones are still being written
+uint when_neq(uint a, uint b) { return uint(a != b); }
+vec2 gravity(uint self, vec2 r_self) {
+    vec2 net_a = static_gravity(r_self);
+    for (uint k = 0; k < movable_count; k++) {
+        uint i = movable_index[k];
+        vec2 R = r_0[i] - r_self;
+        float R2 = dot(R, R) + ee * ee;
+        net_a += (G * m[i] / R2) * normalize(R) * when_neq(i, self);
+    }
+
+    return net_a;
+}
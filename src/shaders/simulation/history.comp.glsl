@@ -0,0 +1,18 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) writeonly buffer History { vec2 history[]; };
+layout (std430, set = 0, binding = 1) readonly buffer Positions { vec2 r[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    uint body_count;
+    uint row;
+};
+
+// every body's position after a step, kept in a ring of rows for trails to sample at the steps they fall on
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= body_count) return;
+    history[row * body_count + i] = r[i];
+}
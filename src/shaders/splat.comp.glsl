@@ -0,0 +1,36 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../../include/constants.h"
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) buffer Splat { uint splat[]; };
+layout (std430, set = 0, binding = 1) readonly buffer Positions { vec2 positions[]; };
+layout (std430, set = 0, binding = 2) readonly buffer PreviousPositions { vec2 previous_positions[]; };
+layout (std430, set = 0, binding = 3) readonly buffer Masses { float masses[]; };
+layout (std430, set = 0, binding = 4) readonly buffer Colors { vec4 colors[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    mat4 orthographic;
+    mat4 view;
+    uvec2 size;
+    float alpha;
+    uint body_count;
+};
+
+// each pixel holds its total mass and mass-weighted color, in fixed point since atomic float adds aren't portable
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= body_count) return;
+
+    vec2 position = mix(previous_positions[i], positions[i], alpha);
+    vec2 ndc = (orthographic * view * vec4(position, 0.0, 1.0)).xy;
+    if (any(lessThan(ndc, vec2(-1.0))) || any(greaterThanEqual(ndc, vec2(1.0)))) return;
+
+    uvec2 pixel = min(uvec2((ndc * vec2(0.5, -0.5) + 0.5) * vec2(size)), size - 1);
+    uint index = 4 * (pixel.y * size.x + pixel.x);
+    uint mass = uint(masses[i] * SPLAT_FIXED_POINT);
+    atomicAdd(splat[index + 0], mass);
+    atomicAdd(splat[index + 1], uint(colors[i].r * mass));
+    atomicAdd(splat[index + 2], uint(colors[i].g * mass));
+    atomicAdd(splat[index + 3], uint(colors[i].b * mass));
+}
@@ -0,0 +1,13 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) writeonly buffer Splat { uint splat[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants { uint count; };
+
+// large screens need more workgroups than a dispatch allows, so each invocation strides over the buffer
+void main() {
+    uint stride = gl_NumWorkGroups.x * gl_WorkGroupSize.x;
+    for (uint i = gl_GlobalInvocationID.x; i < count; i += stride) splat[i] = 0;
+}
@@ -0,0 +1,32 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../../include/constants.h"
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) buffer Splat { uint splat[]; };
+layout (std430, set = 0, binding = 1) readonly buffer Positions { vec2 positions[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    mat4 orthographic;
+    mat4 view;
+    vec4 color;
+    uvec2 size;
+    uint tracer_count;
+};
+
+// laid out like the body splat, with every tracer weighing the same
+void main() {
+    uint i = gl_WorkGroupID.y * gl_NumWorkGroups.x * WORKGROUP_SIZE + gl_GlobalInvocationID.x;
+    if (i >= tracer_count) return;
+
+    vec2 ndc = (orthographic * view * vec4(positions[i], 0.0, 1.0)).xy;
+    if (any(lessThan(ndc, vec2(-1.0))) || any(greaterThanEqual(ndc, vec2(1.0)))) return;
+
+    uvec2 pixel = min(uvec2((ndc * vec2(0.5, -0.5) + 0.5) * vec2(size)), size - 1);
+    uint index = 4 * (pixel.y * size.x + pixel.x);
+    uint weight = uint(SPLAT_FIXED_POINT);
+    atomicAdd(splat[index + 0], weight);
+    atomicAdd(splat[index + 1], uint(color.r * weight));
+    atomicAdd(splat[index + 2], uint(color.g * weight));
+    atomicAdd(splat[index + 3], uint(color.b * weight));
+}
@@ -0,0 +1,22 @@
+// lines that keep vertices at uneven times, looked up by time. the including shader defines
+// line_vertex(line, n), line_time(line, n) and line_vertex_count(line) first
+
+// interpolated between the last vertex at or before the time and the one after it, held at the ends
+vec2 line_at_time(uint line, float time) {
+    uint count = line_vertex_count(line);
+    if (count == 0) return vec2(0.0);
+    uint low = 0;
+    uint high = count - 1;
+    if (time >= line_time(line, high)) return line_vertex(line, high);
+    if (time <= line_time(line, low)) return line_vertex(line, low);
+
+    while (high - low > 1) {
+        uint middle = (low + high) / 2;
+        if (line_time(line, middle) <= time) low = middle;
+        else high = middle;
+    }
+
+    float start = line_time(line, low);
+    float end = line_time(line, high);
+    return mix(line_vertex(line, low), line_vertex(line, high), (time - start) / (end - start));
+}
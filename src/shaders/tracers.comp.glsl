@@ -0,0 +1,55 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) buffer TracerPositions { vec2 r[]; };
+layout (std430, set = 0, binding = 1) buffer TracerVelocities { vec2 v[]; };
+layout (std430, set = 0, binding = 2) readonly buffer SimulationPositons { vec2 r_0[]; };
+layout (std430, set = 0, binding = 3) readonly buffer SimulationMasses { float m[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    uint tracer_count;
+    uint body_count;
+    float G;
+    float ee;
+    float dt;
+    uint steps;
+};
+
+shared vec3 tile[WORKGROUP_SIZE];
+
+// tracers have no mass, so only the bodies are summed over: O(bodies) per tracer instead of O(bodies + tracers).
+// every invocation takes part in loading the tiles, so tracers past the end only skip the final write
+void main() {
+    uint i = gl_WorkGroupID.y * gl_NumWorkGroups.x * WORKGROUP_SIZE + gl_GlobalInvocationID.x;
+    bool active = i < tracer_count;
+    vec2 position = active ? r[i] : vec2(0.0);
+    vec2 velocity = active ? v[i] : vec2(0.0);
+
+    // semi-implicit euler, the same scheme the simulation defaults to
+    for (uint n = 0; n < steps; n++) {
+        vec2 acceleration = vec2(0.0);
+        for (uint start = 0; start < body_count; start += WORKGROUP_SIZE) {
+            uint body = start + gl_LocalInvocationID.x;
+            tile[gl_LocalInvocationID.x] = body < body_count ? vec3(r_0[body], m[body]) : vec3(0.0);
+            barrier();
+
+            uint tile_count = min(uint(WORKGROUP_SIZE), body_count - start);
+            for (uint j = 0; j < tile_count; j++) {
+                vec2 R = tile[j].xy - position;
+                float R2 = dot(R, R) + ee * ee;
+                float distance = length(R);
+                if (distance > 0.0) acceleration += (G * tile[j].z / R2) * (R / distance);
+            }
+
+            barrier();
+        }
+
+        velocity += acceleration * dt;
+        position += velocity * dt;
+    }
+
+    if (!active) return;
+    r[i] = position;
+    v[i] = velocity;
+}
@@ -0,0 +1,45 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) writeonly buffer Barycenter {
+    vec2 center;
+    vec2 drift;
+    float mass;
+};
+layout (std430, set = 0, binding = 1) readonly buffer SimulationPositons { vec2 r_0[]; };
+layout (std430, set = 0, binding = 2) readonly buffer SimulationVelocities { vec2 v_0[]; };
+layout (std430, set = 0, binding = 3) readonly buffer SimulationMasses { float m[]; };
+
+layout (std140, set = 2, binding = 0) uniform Constants { uint body_count; };
+
+shared vec4 moments[WORKGROUP_SIZE];
+shared float masses[WORKGROUP_SIZE];
+
+// a single workgroup, each lane sums a stride of the bodies and the lanes are reduced in shared memory, so the
+// barycenter is found once rather than by every tracer being seeded
+void main() {
+    uint lane = gl_LocalInvocationID.x;
+    vec4 moment = vec4(0.0);
+    float total = 0.0;
+    for (uint j = lane; j < body_count; j += WORKGROUP_SIZE) {
+        total += m[j];
+        moment += m[j] * vec4(r_0[j], v_0[j]);
+    }
+
+    moments[lane] = moment;
+    masses[lane] = total;
+    barrier();
+    for (uint half_width = WORKGROUP_SIZE / 2; half_width > 0; half_width /= 2) {
+        if (lane < half_width) {
+            moments[lane] += moments[lane + half_width];
+            masses[lane] += masses[lane + half_width];
+        }
+        barrier();
+    }
+
+    if (lane != 0) return;
+    mass = masses[0];
+    center = mass > 0.0 ? moments[0].xy / mass : vec2(0.0);
+    drift = mass > 0.0 ? moments[0].zw / mass : vec2(0.0);
+}
@@ -0,0 +1,49 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../../include/constants.h"
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) writeonly buffer TracerPositions { vec2 r[]; };
+layout (std430, set = 0, binding = 1) writeonly buffer TracerVelocities { vec2 v[]; };
+layout (std430, set = 0, binding = 2) readonly buffer Barycenter {
+    vec2 center;
+    vec2 drift;
+    float mass;
+};
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    uint tracer_count;
+    float G;
+    float radius;
+    uint seed;
+};
+
+// https://www.pcg-random.org, one round is plenty to scatter neighbouring indices
+uint pcg(uint state) {
+    state = state * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+float random(inout uint state) {
+    state = pcg(state);
+    return float(state) / 4294967296.0;
+}
+
+void main() {
+    uint i = gl_WorkGroupID.y * gl_NumWorkGroups.x * WORKGROUP_SIZE + gl_GlobalInvocationID.x;
+    if (i >= tracer_count) return;
+
+    // every tracer orbits the barycenter as if all the mass sat there
+    if (mass <= 0.0) return;
+
+    // square root of a uniform sample spreads tracers evenly over the disk's area, and the inner
+    // hundredth is left empty so nothing starts out at orbital speeds near the singularity
+    uint state = pcg(i ^ pcg(seed));
+    float distance = radius * sqrt(mix(0.01, 1.0, random(state)));
+    float theta = TAU * random(state);
+    vec2 direction = vec2(cos(theta), sin(theta));
+
+    r[i] = center + distance * direction;
+    v[i] = drift + sqrt(G * mass / distance) * vec2(-direction.y, direction.x);
+}
@@ -1,13 +1,68 @@
 #version 460
 #extension GL_ARB_shading_language_include : enable
 #include "../../include/constants.h"
+#include "workgroup.lib.glsl"
+#include "trail.lib.glsl"
 
-layout (std430, set = 0, binding = 0) writeonly buffer Trails { vec2 trails[][TRAIL_LENGTH]; };
-layout (std430, set = 0, binding = 1) readonly buffer Positions { vec2 positions[]; };
-layout (std140, set = 2, binding = 0) uniform Frame { uint frame; };
+layout (std430, set = 0, binding = 0) buffer Trails { uint trails[][TRAIL_LENGTH]; };
+layout (std430, set = 0, binding = 1) buffer TrailAnchors { TrailAnchor anchors[]; };
+layout (std430, set = 0, binding = 2) readonly buffer TrailBodies { uint bodies[]; };
+layout (std430, set = 0, binding = 3) readonly buffer Positions { vec2 positions[]; };
+layout (std430, set = 0, binding = 4) readonly buffer History { vec2 history[]; };
+layout (std140, set = 2, binding = 0) uniform Frame {
+    uint frame; // the newest sample
+    uint samples; // written this dispatch, ending at frame
+    uint body_count;
+    uint count;
+    bool fill; // every point of the trail, for one that's only just been loaded
+    int first_row; // the history row of the first sample written, rows go up by interval from there
+    uint interval;
+    uint history_count;
+};
 
-layout (local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+// re-anchored on the middle of everything the trail has to hold, with room to grow so it doesn't happen every sample
+void trail_reanchor(uint i, vec2 position) {
+    TrailAnchor anchor = anchors[i];
+    vec2 low = position;
+    vec2 high = position;
+    for (uint n = 0; n < TRAIL_LENGTH; n++) {
+        vec2 point = trail_decode(anchor, trails[i][n]);
+        low = min(low, point);
+        high = max(high, point);
+    }
+
+    vec2 reach = 0.5 * (high - low);
+    TrailAnchor moved = TrailAnchor(0.5 * (low + high), max(TRAIL_EXTENT_MIN, 2.0 * max(reach.x, reach.y)), 0.0);
+    for (uint n = 0; n < TRAIL_LENGTH; n++) trails[i][n] = trail_encode(moved, trail_decode(anchor, trails[i][n]));
+    anchors[i] = moved;
+}
+
+// one invocation per trail, a body added since the simulation's last step keeps the trail it started with.
+// each sample is the body's position at the step it falls on, taken from the simulation's history. one the
+// history no longer holds is spread evenly between the last sample and the body's position instead
 void main() {
     uint i = gl_GlobalInvocationID.x;
-    trails[i][frame] = positions[i];
+    if (i >= count) return;
+    uint body = bodies[i];
+    if (body >= body_count) return;
+    vec2 position = positions[body];
+    if (fill) {
+        anchors[i] = TrailAnchor(position, TRAIL_EXTENT_MIN, 0.0);
+        for (uint n = 0; n < TRAIL_LENGTH; n++) trails[i][n] = trail_encode(anchors[i], position);
+        return;
+    }
+
+    uint last = (frame + TRAIL_LENGTH - samples) % TRAIL_LENGTH;
+    vec2 previous = trail_decode(anchors[i], trails[i][last]);
+    vec2 offset = abs(position - anchors[i].origin);
+    if (max(offset.x, offset.y) > anchors[i].extent) trail_reanchor(i, position);
+
+    TrailAnchor anchor = anchors[i];
+    for (uint s = 1; s <= samples; s++) {
+        int row = first_row + int((s - 1) * interval);
+        vec2 point = row >= 0 && row < int(history_count)
+            ? history[uint(row) * body_count + body]
+            : mix(previous, position, float(s) / float(samples));
+        trails[i][(last + s) % TRAIL_LENGTH] = trail_encode(anchor, point);
+    }
 }
@@ -0,0 +1,16 @@
+// trail points are kept as 16 bit offsets from their trail's anchor, scaled by how far the trail reaches from it.
+// a trail is re-anchored once a point falls outside that reach, so precision follows the trail's own size
+
+struct TrailAnchor {
+    vec2 origin;
+    float extent;
+    float _padding;
+};
+
+vec2 trail_decode(TrailAnchor anchor, uint point) {
+    return anchor.origin + unpackSnorm2x16(point) * anchor.extent;
+}
+
+uint trail_encode(TrailAnchor anchor, vec2 point) {
+    return packSnorm2x16((point - anchor.origin) / anchor.extent);
+}
@@ -1,13 +1,18 @@
 #version 460
 #extension GL_ARB_shading_language_include : enable
 #include "../../include/constants.h"
+#include "workgroup.lib.glsl"
 
 layout (std430, set = 0, binding = 0) buffer TrajectoryPositions { vec2 r[][PREDICTION_LENGTH]; };
-layout (std430, set = 0, binding = 1) buffer TrajectoryVelocities { vec2 v[]; };
-layout (std430, set = 0, binding = 2) readonly buffer SimulationPositions { vec2 r_0[]; };
-layout (std430, set = 0, binding = 3) readonly buffer SimulationVelocities { vec2 v_0[]; };
-layout (std430, set = 0, binding = 4) readonly buffer Masses { float m[]; };
-layout (std430, set = 0, binding = 5) readonly buffer Movable { float mov[]; };
+layout (std430, set = 0, binding = 1) buffer TrajectoryTimes { float t[][PREDICTION_LENGTH]; };
+layout (std430, set = 0, binding = 2) buffer TrajectoryVertexCounts { uint vertex_count[]; };
+layout (std430, set = 0, binding = 3) buffer TrajectoryVelocities { vec2 v[]; };
+layout (std430, set = 0, binding = 4) buffer TrajectoryState { vec2 s[]; };
+layout (std430, set = 0, binding = 5) buffer TrajectorySamples { vec4 samples[]; };
+layout (std430, set = 0, binding = 6) readonly buffer SimulationPositions { vec2 r_0[]; };
+layout (std430, set = 0, binding = 7) readonly buffer SimulationVelocities { vec2 v_0[]; };
+layout (std430, set = 0, binding = 8) readonly buffer Masses { float m[]; };
+layout (std430, set = 0, binding = 9) readonly buffer TrajectorySlots { uint slots[]; };
 
 layout (std140, set = 2, binding = 0) uniform Constants {
     uint body_count;
@@ -16,22 +21,32 @@ layout (std140, set = 2, binding = 0) uniform Constants {
     float dt;
     float m_g;
     bool ghost_mode;
+    uint steps;
+    float sample_distance;
+    uint count;
 };
 
 layout (std140, set = 2, binding = 1) uniform Frame { uint frame; };
 
+#include "trajectory.lib.glsl"
+
+// positions are integrated in s, alternating between two halves of it every step, and only kept in r where the
+// prediction turns or has gone far enough. the last step is always kept so the line reaches the horizon
+uint slot(uint n, uint body) { return (n & 1) * (body_count + 1) + body; }
+
 uint when_neq(uint a, uint b) { return uint(a != b); }
-vec2 gravity(uint self, uint frame) {
+vec2 gravity(uint self, uint n) {
+    vec2 r_self = s[slot(n, self)];
     vec2 net_a = vec2(0.0);
     for (uint i = 0; i < body_count; i++) {
-        vec2 R = r[i][frame - 1] - r[self][frame - 1];
+        vec2 R = s[slot(n, i)] - r_self;
         float R2 = dot(R, R) + ee * ee;
         net_a += (G * m[i] / R2) * normalize(R) * when_neq(i, self);
     }
 
     bool is_ghost = (self == body_count);
     if (ghost_mode && !is_ghost) {
-        vec2 R = r[body_count][frame - 1] - r[self][frame - 1];
+        vec2 R = s[slot(n, body_count)] - r_self;
         float R2 = dot(R, R) + ee * ee;
         net_a += (G * m_g / R2) * normalize(R);
     }
@@ -39,16 +54,41 @@ vec2 gravity(uint self, uint frame) {
     return net_a;
 }
 
-layout (local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+// a prediction that runs out of vertices just stops short of the horizon. k is the body's slot among the kept ones
+void keep(uint k, uint i, vec2 position, vec2 heading) {
+    uint n = vertex_count[k];
+    if (n >= PREDICTION_LENGTH) return;
+    r[k][n] = position;
+    t[k][n] = float(frame);
+    vertex_count[k] = n + 1;
+    samples[i] = vec4(position, heading);
+}
+
 void main() {
     uint i = gl_GlobalInvocationID.x;
+    if (i > body_count || (i == body_count && !ghost_mode)) return;
 
+    // the ghost's starting point is written in before the first step, and it's always kept after the bodies
     bool is_ghost = (i == body_count);
-    if (frame != 0) {
-        v[i] += gravity(i, frame) * dt;
-        r[i][frame] = r[i][frame - 1] + v[i] * dt;
-    } else if (!is_ghost) {
-        r[i][frame] = r_0[i];
-        v[i] = v_0[i];
+    uint k = is_ghost ? count : slots[i];
+    if (frame == 0) {
+        if (!is_ghost) {
+            s[slot(0, i)] = r_0[i];
+            v[i] = v_0[i];
+        }
+
+        if (k == uint(-1)) return;
+        vertex_count[k] = 0;
+        keep(k, i, s[slot(0, i)], trajectory_heading(v[i], vec2(0.0)));
+        return;
     }
+
+    v[i] += gravity(i, frame - 1) * dt;
+    vec2 position = s[slot(frame - 1, i)] + v[i] * dt;
+    s[slot(frame, i)] = position;
+    if (k == uint(-1)) return;
+
+    vec4 last = samples[i];
+    vec2 heading = trajectory_heading(v[i], last.zw);
+    if (frame + 1 == steps || trajectory_sample(last, position, heading)) keep(k, i, position, heading);
 }
@@ -0,0 +1,14 @@
+// when a prediction keeps a vertex: once it has turned further than PREDICTION_SAMPLE_ANGLE or travelled further than
+// sample_distance since the last one it kept. the including shader declares the sample_distance uniform
+
+// the direction of travel, or the last one for a prediction that has stopped
+vec2 trajectory_heading(vec2 velocity, vec2 heading) {
+    float speed = length(velocity);
+    return speed > 0.0 ? velocity / speed : heading;
+}
+
+// last holds the position and heading of the last kept vertex
+bool trajectory_sample(vec4 last, vec2 position, vec2 heading) {
+    bool turned = dot(last.zw, last.zw) > 0.0 && dot(last.zw, heading) < cos(PREDICTION_SAMPLE_ANGLE);
+    return turned || distance(last.xy, position) > sample_distance;
+}
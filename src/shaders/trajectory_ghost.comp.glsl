@@ -0,0 +1,110 @@
+#version 460
+#extension GL_ARB_shading_language_include : enable
+#include "../../include/constants.h"
+#include "workgroup.lib.glsl"
+
+layout (std430, set = 0, binding = 0) buffer TrajectoryPositions { vec2 r[][PREDICTION_LENGTH]; };
+layout (std430, set = 0, binding = 1) buffer TrajectoryTimes { float t[][PREDICTION_LENGTH]; };
+layout (std430, set = 0, binding = 2) buffer TrajectoryVertexCounts { uint vertex_count[]; };
+layout (std430, set = 0, binding = 3) readonly buffer Masses { float m[]; };
+layout (std430, set = 0, binding = 4) buffer Cursors { uint cursor[]; };
+layout (std430, set = 0, binding = 5) buffer GhostState {
+    vec2 ghost_position;
+    vec2 ghost_velocity;
+    vec4 ghost_last; // position and heading of the last kept vertex
+    uint ghost_kept;
+};
+
+layout (std140, set = 2, binding = 0) uniform Constants {
+    vec2 r_g;
+    vec2 v_g;
+    uint body_count;
+    float G;
+    float ee;
+    float dt;
+    uint steps;
+    float sample_distance;
+    uint begin; // the slice of steps this dispatch walks
+    uint end;
+};
+
+#include "trajectory.lib.glsl"
+
+shared vec2 partial[WORKGROUP_SIZE];
+
+// where a body's prediction had it at a time, its vertices were kept at uneven steps so each body keeps a cursor
+// into them that only ever moves forward. each body only ever belongs to the same invocation
+vec2 body_at(uint i, float time) {
+    uint count = vertex_count[i];
+    uint c = cursor[i];
+    while (c + 1 < count && t[i][c + 1] <= time) c++;
+    cursor[i] = c;
+    if (c + 1 >= count) return r[i][c];
+    return mix(r[i][c], r[i][c + 1], (time - t[i][c]) / (t[i][c + 1] - t[i][c]));
+}
+
+// the ghost as a test particle flying through the bodies' cached predictions, which it doesn't pull on. a single
+// workgroup walks the steps in order, sharing out each step's sum over the bodies and reducing it in shared memory.
+// every body was kept for it, so their slots are their own indices and the ghost's comes right after them.
+// the steps are walked a slice per dispatch, with the ghost carried between them in GhostState
+void main() {
+    uint lane = gl_LocalInvocationID.x;
+    vec2 position = r_g;
+    vec2 velocity = v_g;
+    vec4 last = vec4(position, trajectory_heading(velocity, vec2(0.0)));
+    uint kept = 1;
+    if (begin <= 1) {
+        for (uint i = lane; i < body_count; i += WORKGROUP_SIZE) cursor[i] = 0;
+        if (lane == 0) {
+            r[body_count][0] = position;
+            t[body_count][0] = 0.0;
+        }
+    } else {
+        position = ghost_position;
+        velocity = ghost_velocity;
+        last = ghost_last;
+        kept = ghost_kept;
+    }
+
+    for (uint n = max(begin, 1); n < end && kept < PREDICTION_LENGTH; n++) {
+        // the bodies are held where they were a step ago, the same as when they're all integrated together
+        vec2 net_a = vec2(0.0);
+        for (uint i = lane; i < body_count; i += WORKGROUP_SIZE) {
+            vec2 R = body_at(i, float(n - 1)) - position;
+            float R2 = dot(R, R) + ee * ee;
+            net_a += (G * m[i] / R2) * normalize(R);
+        }
+
+        partial[lane] = net_a;
+        barrier();
+        for (uint half_width = WORKGROUP_SIZE / 2; half_width > 0; half_width /= 2) {
+            if (lane < half_width) partial[lane] += partial[lane + half_width];
+            barrier();
+        }
+
+        // every invocation advances its own copy of the ghost, so they all agree without another round trip
+        velocity += partial[0] * dt;
+        position += velocity * dt;
+        barrier();
+
+        vec2 heading = trajectory_heading(velocity, last.zw);
+        if (n + 1 == steps || trajectory_sample(last, position, heading)) {
+            if (lane == 0) {
+                r[body_count][kept] = position;
+                t[body_count][kept] = float(n);
+            }
+
+            last = vec4(position, heading);
+            kept++;
+        }
+    }
+
+    // the prediction is drawn as it grows, up to wherever this slice got to
+    if (lane == 0) {
+        ghost_position = position;
+        ghost_velocity = velocity;
+        ghost_last = last;
+        ghost_kept = kept;
+        vertex_count[body_count] = kept;
+    }
+}
@@ -0,0 +1,6 @@
+// compiled once per size in WORKGROUP_SIZES by compile_shaders.py, invocations past the end must return early
+#ifndef WORKGROUP_SIZE
+#define WORKGROUP_SIZE 1
+#endif
+
+layout (local_size_x = WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
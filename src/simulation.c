@@ -11,16 +11,16 @@ SDL_AppResult simulation_init(Simulation *sim, SDL_GPUDevice *gpu) {
         .softening = SOFTENING_DEFAULT,
         .density = DENSITY_DEFAULT,
         .integrator = INTEGRATOR_DEFAULT,
+        .static_field = STATIC_FIELD_DEFAULT,
+        .history = false,
         .paused = false
     };
 
-    SDL_GPUComputePipeline *euler = CreateGPUComputePipeline(gpu, "shaders/simulation/euler.comp.spv");
-    SDL_GPUComputePipeline *verlet = CreateGPUComputePipeline(gpu, "shaders/simulation/verlet.comp.spv");
-    SDL_GPUComputePipeline *runge_kutta = CreateGPUComputePipeline(gpu, "shaders/simulation/runge_kutta.comp.spv");
-    if (!euler) panic("Failed to create simulation euler compute pipeline!");
-    if (!verlet) panic("Failed to create simulation verlet compute pipeline!");
-    if (!runge_kutta) panic("Failed to create simulation runge kutta compute pipeline!");
-    memcpy(sim->integrators, (SDL_GPUComputePipeline*[3]) { euler, verlet, runge_kutta }, sizeof(sim->integrators));
+    if (!kernel_init(&sim->integrators[INTEGRATOR_EULER], gpu, "shaders/simulation/euler.comp")) panic("Failed to create simulation euler compute pipeline!");
+    if (!kernel_init(&sim->integrators[INTEGRATOR_VERLET], gpu, "shaders/simulation/verlet.comp")) panic("Failed to create simulation verlet compute pipeline!");
+    if (!kernel_init(&sim->integrators[INTEGRATOR_RUNGE_KUTTA_4], gpu, "shaders/simulation/runge_kutta.comp")) panic("Failed to create simulation runge kutta compute pipeline!");
+    if (!kernel_init(&sim->static_field.kernel, gpu, "shaders/field_grid.comp")) panic("Failed to create static field compute pipeline!");
+    if (!kernel_init(&sim->history_kernel, gpu, "shaders/simulation/history.comp")) panic("Failed to create simulation history compute pipeline!");
 
     sim->current_buffer = SIM_POSITIONS_A;
     sim->positions_a = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
@@ -34,6 +34,20 @@ SDL_AppResult simulation_init(Simulation *sim, SDL_GPUDevice *gpu) {
     if (!sim->masses.buffer) panic("Failed to create simulation masses buffer!");
     if (!sim->movable.buffer) panic("Failed to create simulation movable buffer!");
 
+    sim->movable_indices = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READDRAW);
+    sim->static_positions = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READDRAW);
+    sim->static_masses = CreateGPUArray(gpu, sizeof(f32), SDL_GPU_BUFFERUSAGE_READDRAW);
+    sim->static_field.grid = CreateGPUArray(gpu, sizeof(HMM_Vec4), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    if (!sim->movable_indices.buffer) panic("Failed to create simulation movable indices buffer!");
+    if (!sim->static_positions.buffer) panic("Failed to create simulation static positions buffer!");
+    if (!sim->static_masses.buffer) panic("Failed to create simulation static masses buffer!");
+    if (!sim->static_field.grid.buffer) panic("Failed to create simulation static field buffer!");
+
+    sim->history = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    if (!sim->history.buffer) panic("Failed to create simulation history buffer!");
+    sim->history_body_count = 0;
+    sim->history_start = 0;
+
     return SDL_APP_CONTINUE;
 }
 
@@ -50,7 +64,134 @@ u32 simulation_add_body(
         { .array = &sim->masses, .source = (u8*) &body->mass, .size = sizeof(f32) },
         { .array = &sim->movable, .source = (u8*) &(f32) { body->movable }, .size = sizeof(f32) },
     }, 5);
-    return sim->body_count++;
+
+    const u32 index = sim->body_count++;
+    if (body->movable) {
+        AppendGPUArrays(gpu, copy_pass, &(AppendGPUArrayBinding) {
+            .array = &sim->movable_indices, .source = (u8*) &index, .size = sizeof(u32)
+        }, 1);
+        sim->movable_count++;
+        return index;
+    }
+
+    AppendGPUArrays(gpu, copy_pass, (AppendGPUArrayBinding[]) {
+        { .array = &sim->static_positions, .source = (u8*) &body->position, .size = sizeof(HMM_Vec2) },
+        { .array = &sim->static_masses, .source = (u8*) &body->mass, .size = sizeof(f32) },
+    }, 2);
+
+    SimulationStaticField *field = &sim->static_field;
+    if (!sim->static_count++) {
+        field->min = field->max = field->center = body->position;
+        field->mass = body->mass;
+    } else {
+        field->min = HMM_V2(SDL_min(field->min.X, body->position.X), SDL_min(field->min.Y, body->position.Y));
+        field->max = HMM_V2(SDL_max(field->max.X, body->position.X), SDL_max(field->max.Y, body->position.Y));
+        const f32 mass = field->mass + body->mass;
+        if (mass > 0.0f) field->center = HMM_DivV2F(HMM_AddV2(HMM_MulV2F(field->center, field->mass), HMM_MulV2F(body->position, body->mass)), mass);
+        field->mass = mass;
+    }
+
+    field->dirty = true;
+    return index;
+}
+
+void simulation_static_update(Simulation *sim, SDL_GPUDevice *gpu, SDL_GPUCommandBuffer *command_buffer) {
+    SimulationStaticField *field = &sim->static_field;
+    if (!sim->options.static_field || sim->static_count < STATIC_FIELD_MIN_BODIES) {
+        field->cached = false;
+        return;
+    }
+
+    const bool stale = field->dirty || field->gravity != sim->options.gravity || field->softening != sim->options.softening;
+    if (field->cached && !stale) return;
+
+    // the grid reaches past the static bodies by a margin, so anything orbiting close around them still samples it
+    const HMM_Vec2 extent = HMM_SubV2(field->max, field->min);
+    const f32 margin = SDL_max(SDL_max(extent.X, extent.Y), 1.0f) * STATIC_FIELD_MARGIN;
+    const HMM_Vec2 size = HMM_AddV2(extent, HMM_V2(2.0f * margin, 2.0f * margin));
+    field->origin = HMM_SubV2(field->min, HMM_V2(margin, margin));
+    field->cell = SDL_max(size.X, size.Y) / (f32) STATIC_FIELD_RESOLUTION;
+    field->size[0] = (u32) SDL_ceilf(size.X / field->cell) + 1;
+    field->size[1] = (u32) SDL_ceilf(size.Y / field->cell) + 1;
+    const u32 cell_count = field->size[0] * field->size[1];
+    ReserveGPUArray(&field->grid, gpu, cell_count * sizeof(HMM_Vec4));
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, &(SDL_GPUStorageBufferReadWriteBinding) {
+        .buffer = field->grid.buffer,
+        .cycle = true
+    }, 1);
+
+    // the same kernel the field module samples the viewport with, forced so it never reads its moved flag
+    const struct {
+        HMM_Vec2 origin;
+        u32 size[2];
+        f32 cell_size;
+        u32 body_count;
+        f32 G;
+        f32 ee;
+        u32 force;
+    } constants = {
+        field->origin,
+        { field->size[0], field->size[1] },
+        field->cell,
+        sim->static_count,
+        sim->options.gravity,
+        sim->options.softening,
+        1
+    };
+
+    SDL_PushGPUComputeUniformData(command_buffer, 0, &constants, sizeof(constants));
+    const u32 groups = kernel_bind(&field->kernel, compute_pass, cell_count);
+    const u32 groups_x = SDL_min(groups, MAX_WORKGROUP_COUNT);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        field->grid.buffer,
+        sim->static_positions.buffer,
+        sim->static_masses.buffer,
+        sim->static_masses.buffer
+    }, 4);
+    SDL_DispatchGPUCompute(compute_pass, groups_x, (groups + groups_x - 1) / groups_x, 1);
+    SDL_EndGPUComputePass(compute_pass);
+
+    field->gravity = sim->options.gravity;
+    field->softening = sim->options.softening;
+    field->dirty = false;
+    field->cached = true;
+}
+
+// rows are laid out by body count, so adding a body or switching the history off starts it over
+void simulation_history_reserve(Simulation *sim, SDL_GPUDevice *gpu) {
+    if (!sim->options.history || !sim->body_count) {
+        sim->history_start = sim->step;
+        return;
+    }
+
+    if (sim->history_body_count == sim->body_count) return;
+    ReserveGPUArray(&sim->history, gpu, SIMULATION_HISTORY_LENGTH * sim->body_count * sizeof(HMM_Vec2));
+    sim->history_body_count = sim->body_count;
+    sim->history_start = sim->step;
+}
+
+static void simulation_history_record(
+    Simulation *sim,
+    SDL_GPUCommandBuffer *command_buffer,
+    SDL_GPUComputePass *compute_pass
+) {
+    if (!sim->options.history || sim->history_body_count != sim->body_count) {
+        sim->history_start = sim->step;
+        return;
+    }
+
+    const struct {
+        u32 body_count;
+        u32 row;
+    } constants = { sim->body_count, (u32) (sim->step % SIMULATION_HISTORY_LENGTH) };
+    SDL_PushGPUComputeUniformData(command_buffer, 0, &constants, sizeof(constants));
+    const u32 groups = kernel_bind(&sim->history_kernel, compute_pass, sim->body_count);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        sim->history.buffer,
+        simulation_positions(sim)
+    }, 2);
+    SDL_DispatchGPUCompute(compute_pass, groups, 1, 1);
 }
 
 void simulation_update(
@@ -61,22 +202,37 @@ void simulation_update(
 ) {
     if (sim->options.paused || !sim->body_count) return;
 
+    const SimulationStaticField *field = &sim->static_field;
     const struct {
-        u32 body_count;
+        HMM_Vec2 grid_origin;
+        u32 grid_size[2];
+        HMM_Vec2 static_center;
+        f32 grid_cell;
+        u32 movable_count;
+        u32 static_count;
         f32 gravity;
         f32 softening;
         f32 delta_time;
+        f32 static_mass;
+        u32 static_cached;
     } constants = {
-        sim->body_count,
+        field->origin,
+        { field->size[0], field->size[1] },
+        field->center,
+        field->cell,
+        sim->movable_count,
+        sim->static_count,
         sim->options.gravity,
         sim->options.softening,
-        delta_time
+        delta_time,
+        field->mass,
+        field->cached
     };
 
     SDL_PushGPUComputeUniformData(command_buffer, 0, &constants, sizeof(constants));
 
-    SDL_GPUComputePipeline *integrator = sim->integrators[sim->options.integrator];
-    SDL_BindGPUComputePipeline(compute_pass, integrator);
+    // static bodies are never dispatched, both position buffers already hold where they sit
+    const u32 groups = kernel_bind(&sim->integrators[sim->options.integrator], compute_pass, sim->movable_count);
 
     if (sim->current_buffer == SIM_POSITIONS_A) {
         SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
@@ -95,16 +251,147 @@ void simulation_update(
     SDL_BindGPUComputeStorageBuffers(compute_pass, 2, (SDL_GPUBuffer*[]) {
         sim->velocities.buffer,
         sim->masses.buffer,
-        sim->movable.buffer
-    }, 3);
-    SDL_DispatchGPUCompute(compute_pass, sim->body_count, 1, 1);
+        sim->movable_indices.buffer,
+        sim->static_positions.buffer,
+        sim->static_masses.buffer,
+        field->grid.buffer
+    }, 6);
+    if (sim->movable_count) SDL_DispatchGPUCompute(compute_pass, groups, 1, 1);
+    sim->step++;
+    simulation_history_record(sim, command_buffer, compute_pass);
+}
+
+SDL_GPUBuffer *simulation_positions(const Simulation *sim) {
+    // current_buffer is the one the next step writes into
+    return sim->current_buffer == SIM_POSITIONS_A ? sim->positions_b.buffer : sim->positions_a.buffer;
+}
+
+SDL_GPUBuffer *simulation_previous_positions(const Simulation *sim) {
+    return sim->current_buffer == SIM_POSITIONS_A ? sim->positions_a.buffer : sim->positions_b.buffer;
+}
+
+void simulation_frame_init(SimulationFrame *frame, SDL_GPUDevice *gpu) {
+    *frame = (SimulationFrame) {
+        .positions = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW),
+        .previous_positions = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW),
+        .velocities = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW),
+        .masses = CreateGPUArray(gpu, sizeof(f32), SDL_GPU_BUFFERUSAGE_READDRAW),
+        .movable = CreateGPUArray(gpu, sizeof(f32), SDL_GPU_BUFFERUSAGE_READDRAW),
+        .history = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW),
+    };
+}
+
+static void simulation_copy(SDL_GPUCopyPass *copy_pass, SDL_GPUBuffer *source, GPUArray *destination, const u32 size) {
+    SDL_CopyGPUBufferToBuffer(
+        copy_pass,
+        &(SDL_GPUBufferLocation) { .buffer = source, .offset = 0 },
+        &(SDL_GPUBufferLocation) { .buffer = destination->buffer, .offset = 0 },
+        size,
+        false
+    );
+    destination->used = size;
+}
+
+// the steps the reader hasn't seen yet, everything after since, as far back as the ring still holds them
+static void simulation_publish_history(const Simulation *sim, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass, SimulationFrame *frame, const u64 since) {
+    frame->history_count = 0;
+    frame->history_step = sim->step + 1;
+    if (!sim->options.history || sim->history_body_count != sim->body_count) return;
+
+    const u64 oldest = sim->step >= SIMULATION_HISTORY_LENGTH ? sim->step - SIMULATION_HISTORY_LENGTH : 0;
+    const u64 first = SDL_max(SDL_max(since, sim->history_start), oldest) + 1;
+    if (first > sim->step) return;
+
+    const u32 count = (u32) (sim->step - first + 1);
+    const u32 row_size = sim->body_count * sizeof(HMM_Vec2);
+    ReserveGPUArray(&frame->history, gpu, count * row_size);
+
+    // the ring wraps at most once
+    const u32 first_row = (u32) (first % SIMULATION_HISTORY_LENGTH);
+    const u32 head = SDL_min(count, SIMULATION_HISTORY_LENGTH - first_row);
+    SDL_CopyGPUBufferToBuffer(copy_pass, &(SDL_GPUBufferLocation) {
+        .buffer = sim->history.buffer,
+        .offset = first_row * row_size
+    }, &(SDL_GPUBufferLocation) {
+        .buffer = frame->history.buffer,
+        .offset = 0
+    }, head * row_size, false);
+    if (head < count) {
+        SDL_CopyGPUBufferToBuffer(copy_pass, &(SDL_GPUBufferLocation) {
+            .buffer = sim->history.buffer,
+            .offset = 0
+        }, &(SDL_GPUBufferLocation) {
+            .buffer = frame->history.buffer,
+            .offset = head * row_size
+        }, (count - head) * row_size, false);
+    }
+
+    frame->history.used = count * row_size;
+    frame->history_count = count;
+    frame->history_step = first;
+}
+
+void simulation_publish(
+    const Simulation *sim,
+    SDL_GPUDevice *gpu,
+    SDL_GPUCopyPass *copy_pass,
+    SimulationFrame *frame,
+    const u64 since
+) {
+    frame->options = sim->options;
+    frame->step = sim->step;
+    frame->history_count = 0;
+    if (!sim->body_count) return;
+
+    const u32 vectors_size = sim->body_count * sizeof(HMM_Vec2);
+    const u32 scalars_size = sim->body_count * sizeof(f32);
+    ReserveGPUArray(&frame->positions, gpu, vectors_size);
+    ReserveGPUArray(&frame->previous_positions, gpu, vectors_size);
+    ReserveGPUArray(&frame->velocities, gpu, vectors_size);
+    simulation_copy(copy_pass, simulation_positions(sim), &frame->positions, vectors_size);
+    simulation_copy(copy_pass, simulation_previous_positions(sim), &frame->previous_positions, vectors_size);
+    simulation_copy(copy_pass, sim->velocities.buffer, &frame->velocities, vectors_size);
+
+    // masses and movability only change when bodies are added
+    if (frame->body_count != sim->body_count) {
+        ReserveGPUArray(&frame->masses, gpu, scalars_size);
+        ReserveGPUArray(&frame->movable, gpu, scalars_size);
+        simulation_copy(copy_pass, sim->masses.buffer, &frame->masses, scalars_size);
+        simulation_copy(copy_pass, sim->movable.buffer, &frame->movable, scalars_size);
+        frame->body_count = sim->body_count;
+    }
+
+    simulation_publish_history(sim, gpu, copy_pass, frame, since);
+}
+
+f32 simulation_frame_alpha(const SimulationFrame *frame, const u64 tick) {
+    // how far between the previous and current positions the present moment is
+    if (frame->options.paused || frame->delta_time <= 0.0f) return 1.0f;
+    const f32 elapsed = (f32) ((i64) tick - (i64) frame->tick) / (f32) SDL_NS_PER_SECOND;
+    return SDL_clamp((frame->accumulator + elapsed) / frame->delta_time, 0.0f, 1.0f);
+}
+
+void simulation_frame_free(const SimulationFrame *frame, SDL_GPUDevice *gpu) {
+    SDL_ReleaseGPUBuffer(gpu, frame->positions.buffer);
+    SDL_ReleaseGPUBuffer(gpu, frame->previous_positions.buffer);
+    SDL_ReleaseGPUBuffer(gpu, frame->velocities.buffer);
+    SDL_ReleaseGPUBuffer(gpu, frame->masses.buffer);
+    SDL_ReleaseGPUBuffer(gpu, frame->movable.buffer);
+    SDL_ReleaseGPUBuffer(gpu, frame->history.buffer);
 }
 
 void simulation_free(const Simulation *sim, SDL_GPUDevice *gpu) {
-    for (u8 i = 0; i < 3; i++) SDL_ReleaseGPUComputePipeline(gpu, sim->integrators[i]);
+    for (u8 i = 0; i < 3; i++) kernel_free(&sim->integrators[i], gpu);
+    kernel_free(&sim->static_field.kernel, gpu);
+    kernel_free(&sim->history_kernel, gpu);
+    SDL_ReleaseGPUBuffer(gpu, sim->history.buffer);
     SDL_ReleaseGPUBuffer(gpu, sim->positions_a.buffer);
     SDL_ReleaseGPUBuffer(gpu, sim->positions_b.buffer);
     SDL_ReleaseGPUBuffer(gpu, sim->velocities.buffer);
     SDL_ReleaseGPUBuffer(gpu, sim->masses.buffer);
     SDL_ReleaseGPUBuffer(gpu, sim->movable.buffer);
+    SDL_ReleaseGPUBuffer(gpu, sim->movable_indices.buffer);
+    SDL_ReleaseGPUBuffer(gpu, sim->static_positions.buffer);
+    SDL_ReleaseGPUBuffer(gpu, sim->static_masses.buffer);
+    SDL_ReleaseGPUBuffer(gpu, sim->static_field.grid.buffer);
 }
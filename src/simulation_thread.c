@@ -0,0 +1,226 @@
+#include "simulation_thread.h"
+#include "constants.h"
+
+#define FRAME_FRESH 0x4
+#define FRAME_INDEX 0x3
+
+static int simulation_thread_run(void *data);
+SDL_AppResult simulation_thread_init(SimulationThread *thread, SDL_GPUDevice *gpu) {
+    thread->gpu = gpu;
+    thread->fixed_delta_time = FIXED_DELTA_TIME_DEFAULT;
+    scheduler_init(&thread->scheduler);
+    if (simulation_init(&thread->sim, gpu) != 0) panic("Failed to initialize simulation!");
+
+    for (u32 i = 0; i < 3; i++) {
+        simulation_frame_init(&thread->frames[i], gpu);
+        if (!thread->frames[i].positions.buffer) panic("Failed to create simulation frame positions buffer!");
+        if (!thread->frames[i].previous_positions.buffer) panic("Failed to create simulation frame previous positions buffer!");
+        if (!thread->frames[i].velocities.buffer) panic("Failed to create simulation frame velocities buffer!");
+        if (!thread->frames[i].masses.buffer) panic("Failed to create simulation frame masses buffer!");
+        if (!thread->frames[i].movable.buffer) panic("Failed to create simulation frame movable buffer!");
+        thread->frames[i].options = thread->sim.options;
+    }
+
+    thread->sent = (SimulationCommand) {
+        .type = SIMULATION_COMMAND_OPTIONS,
+        .options = {
+            .sim = thread->sim.options,
+            .scheduler = thread->scheduler.options,
+            .fixed_delta_time = thread->fixed_delta_time
+        }
+    };
+
+    for (u32 i = 0; i < 3; i++) thread->readers[i] = 0;
+    SDL_SetAtomicU32(&thread->retired, 0);
+    thread->write = 0;
+    thread->published = 0;
+    thread->consumed = 0;
+    SDL_SetAtomicInt(&thread->ready, 1);
+    thread->read = 2;
+    SDL_SetAtomicInt(&thread->head, 0);
+    SDL_SetAtomicInt(&thread->tail, 0);
+    SDL_SetAtomicInt(&thread->quit, 0);
+
+    thread->wake = SDL_CreateSemaphore(0);
+    if (!thread->wake) panic("Failed to create simulation thread semaphore!");
+    thread->thread = SDL_CreateThread(simulation_thread_run, "simulation", thread);
+    if (!thread->thread) panic("Failed to create simulation thread!");
+    return SDL_APP_CONTINUE;
+}
+
+bool simulation_thread_push(SimulationThread *thread, const SimulationCommand *command) {
+    const i32 tail = SDL_GetAtomicInt(&thread->tail);
+    const i32 next = (tail + 1) % SIMULATION_QUEUE_LENGTH;
+    if (next == SDL_GetAtomicInt(&thread->head)) return false;
+
+    thread->commands[tail] = *command;
+    SDL_SetAtomicInt(&thread->tail, next);
+
+    // options are picked up on the next step, only new bodies are worth waking up for
+    if (command->type == SIMULATION_COMMAND_ADD_BODY) SDL_SignalSemaphore(thread->wake);
+    return true;
+}
+
+static bool simulation_options_equal(const SimulationOptions *a, const SimulationOptions *b) {
+    return a->integrator == b->integrator
+        && a->gravity == b->gravity
+        && a->softening == b->softening
+        && a->density == b->density
+        && a->static_field == b->static_field
+        && a->history == b->history
+        && a->paused == b->paused;
+}
+
+// a full queue leaves the options unsent, so they're tried again the next time
+void simulation_thread_push_options(
+    SimulationThread *thread,
+    const SimulationOptions *sim,
+    const SchedulerOptions *scheduler,
+    const f32 fixed_delta_time
+) {
+    const SimulationCommand *sent = &thread->sent;
+    if (simulation_options_equal(&sent->options.sim, sim)
+        && sent->options.scheduler.budget == scheduler->budget
+        && sent->options.fixed_delta_time == fixed_delta_time) return;
+
+    const SimulationCommand command = {
+        .type = SIMULATION_COMMAND_OPTIONS,
+        .options = { .sim = *sim, .scheduler = *scheduler, .fixed_delta_time = fixed_delta_time }
+    };
+    if (simulation_thread_push(thread, &command)) thread->sent = command;
+}
+
+// render_frame is the render frame about to read whatever is returned
+const SimulationFrame *simulation_thread_acquire(SimulationThread *thread, const u32 render_frame) {
+    if (SDL_GetAtomicInt(&thread->ready) & FRAME_FRESH) {
+        const i32 previous = SDL_SetAtomicInt(&thread->ready, (i32) thread->read);
+        thread->read = (u32) previous & FRAME_INDEX;
+    }
+
+    thread->readers[thread->read] = render_frame;
+    return &thread->frames[thread->read];
+}
+
+// called by the render thread with the latest render frame the GPU has finished
+void simulation_thread_retire(SimulationThread *thread, const u32 render_frame) {
+    SDL_SetAtomicU32(&thread->retired, render_frame);
+}
+
+// the frame about to be written was handed back by the render thread, which may still have rendering in flight
+// that reads it. serials wrap, so they're compared by their difference
+static void simulation_thread_wait_readers(SimulationThread *thread) {
+    const u32 reader = thread->readers[thread->write];
+    while ((i32) (reader - SDL_GetAtomicU32(&thread->retired)) > 0 && !SDL_GetAtomicInt(&thread->quit)) SDL_Delay(1);
+}
+
+static bool simulation_thread_drain(SimulationThread *thread) {
+    i32 head = SDL_GetAtomicInt(&thread->head);
+    const i32 tail = SDL_GetAtomicInt(&thread->tail);
+    if (head == tail) return false;
+
+    bool dirty = false;
+    SDL_GPUCommandBuffer *command_buffer = NULL;
+    SDL_GPUCopyPass *copy_pass = NULL;
+    for (; head != tail; head = (head + 1) % SIMULATION_QUEUE_LENGTH) {
+        const SimulationCommand *command = &thread->commands[head];
+        switch (command->type) {
+            case SIMULATION_COMMAND_ADD_BODY:
+                if (!copy_pass) {
+                    command_buffer = SDL_AcquireGPUCommandBuffer(thread->gpu);
+                    copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+                }
+
+                simulation_add_body(&thread->sim, thread->gpu, copy_pass, &command->body);
+                dirty = true;
+                break;
+            case SIMULATION_COMMAND_OPTIONS:
+                dirty |= !simulation_options_equal(&thread->sim.options, &command->options.sim);
+                thread->sim.options = command->options.sim;
+                thread->scheduler.options = command->options.scheduler;
+                thread->fixed_delta_time = command->options.fixed_delta_time;
+                break;
+        }
+    }
+
+    SDL_SetAtomicInt(&thread->head, head);
+    if (copy_pass) {
+        SDL_EndGPUCopyPass(copy_pass);
+        SDL_SubmitGPUCommandBuffer(command_buffer);
+    }
+
+    return dirty;
+}
+
+static void simulation_thread_step(SimulationThread *thread, const u32 steps, const u64 tick) {
+    Simulation *sim = &thread->sim;
+    SimulationFrame *frame = &thread->frames[thread->write];
+    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(thread->gpu);
+    simulation_static_update(sim, thread->gpu, command_buffer);
+    simulation_history_reserve(sim, thread->gpu);
+
+    if (steps) {
+        SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+            { .buffer = sim->positions_a.buffer, .cycle = false },
+            { .buffer = sim->positions_b.buffer, .cycle = false },
+            { .buffer = sim->velocities.buffer, .cycle = false },
+            { .buffer = sim->history.buffer, .cycle = false },
+        }, 4);
+
+        for (u32 i = 0; i < steps; i++) simulation_update(sim, command_buffer, compute_pass, thread->fixed_delta_time);
+        SDL_EndGPUComputePass(compute_pass);
+    }
+
+    simulation_thread_wait_readers(thread);
+    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+    // once the last frame has been picked up its steps are the reader's; a race only widens the history
+    if (!(SDL_GetAtomicInt(&thread->ready) & FRAME_FRESH)) thread->consumed = thread->published;
+    simulation_publish(sim, thread->gpu, copy_pass, frame, thread->consumed);
+    SDL_EndGPUCopyPass(copy_pass);
+    scheduler_submit(&thread->scheduler, thread->gpu, command_buffer, SCHEDULER_WORK_STEPS, steps);
+    scheduler_wait(&thread->scheduler, thread->gpu);
+
+    frame->version = ++thread->version;
+    frame->tick = tick;
+    frame->accumulator = thread->scheduler.accumulator;
+    frame->delta_time = thread->fixed_delta_time;
+    frame->time_dilation = thread->scheduler.time_dilation;
+    frame->behind = thread->scheduler.behind;
+    const i32 previous = SDL_SetAtomicInt(&thread->ready, (i32) (thread->write | FRAME_FRESH));
+    thread->write = (u32) previous & FRAME_INDEX;
+    thread->published = sim->step;
+}
+
+static int simulation_thread_run(void *data) {
+    SimulationThread *thread = data;
+    u64 last_tick = SDL_GetTicksNS();
+
+    while (!SDL_GetAtomicInt(&thread->quit)) {
+        const bool dirty = simulation_thread_drain(thread);
+
+        const u64 current_tick = SDL_GetTicksNS();
+        const f32 delta_time = (f32) (current_tick - last_tick) / (f32) SDL_NS_PER_SECOND;
+        last_tick = current_tick;
+
+        const bool paused = thread->sim.options.paused || !thread->sim.body_count || thread->fixed_delta_time <= 0.0f;
+        scheduler_begin(&thread->scheduler, delta_time);
+        const u32 steps = scheduler_plan_steps(&thread->scheduler, delta_time, thread->fixed_delta_time, paused);
+        if (steps || dirty) simulation_thread_step(thread, steps, current_tick);
+
+        // sleep until the next step is due, or until a new body shows up
+        const f32 wait = paused ? SIMULATION_IDLE_WAIT : thread->fixed_delta_time - thread->scheduler.accumulator;
+        SDL_WaitSemaphoreTimeout(thread->wake, (i32) SDL_ceilf(SDL_max(wait * 1000.0f, 0.0f)));
+    }
+
+    return 0;
+}
+
+void simulation_thread_free(SimulationThread *thread, SDL_GPUDevice *gpu) {
+    SDL_SetAtomicInt(&thread->quit, 1);
+    SDL_SignalSemaphore(thread->wake);
+    SDL_WaitThread(thread->thread, NULL);
+    SDL_DestroySemaphore(thread->wake);
+
+    for (u32 i = 0; i < 3; i++) simulation_frame_free(&thread->frames[i], gpu);
+    scheduler_free(&thread->scheduler, gpu);
+    simulation_free(&thread->sim, gpu);
+}
@@ -0,0 +1,180 @@
+#include "tracers.h"
+#include "constants.h"
+#include "simulation.h"
+#include "scheduler.h"
+
+void tracers_init(Tracers *tracers) {
+    tracers->options = (TracerOptions) {
+        .count = TRACER_COUNT_DEFAULT,
+        .radius = TRACER_RADIUS_DEFAULT,
+        .enabled = false
+    };
+    tracers->residency = (GPUResidency) { 0 };
+    tracers->count = 0;
+    tracers->seed = 0;
+    tracers->seeded = false;
+}
+
+// tracers are reseeded once loaded, so nothing needs catching up after a release
+static SDL_AppResult tracers_load(Tracers *tracers, SDL_GPUDevice *gpu) {
+    if (!tracers->residency.loaded) {
+        if (!kernel_init(&tracers->kernel, gpu, "shaders/tracers.comp")) panic("Failed to create tracers compute pipeline!");
+        if (!kernel_init(&tracers->seed_kernel, gpu, "shaders/tracers_seed.comp")) panic("Failed to create tracer seeding compute pipeline!");
+        if (!kernel_init(&tracers->barycenter_kernel, gpu, "shaders/tracers_barycenter.comp")) panic("Failed to create tracer barycenter compute pipeline!");
+        tracers->residency.loaded = true;
+    }
+
+    tracers->positions = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    tracers->velocities = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    if (!tracers->positions.buffer) panic("Failed to create tracer positions buffer!");
+    tracers->barycenter = SDL_CreateGPUBuffer(gpu, &(SDL_GPUBufferCreateInfo) {
+        .usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE,
+        .size = 2 * sizeof(HMM_Vec4)
+    });
+    if (!tracers->velocities.buffer) panic("Failed to create tracer velocities buffer!");
+    if (!tracers->barycenter) panic("Failed to create tracer barycenter buffer!");
+    tracers->residency.resident = true;
+    tracers->seeded = false;
+    return SDL_APP_CONTINUE;
+}
+
+static void tracers_release(Tracers *tracers, SDL_GPUDevice *gpu) {
+    SDL_ReleaseGPUBuffer(gpu, tracers->positions.buffer);
+    SDL_ReleaseGPUBuffer(gpu, tracers->velocities.buffer);
+    SDL_ReleaseGPUBuffer(gpu, tracers->barycenter);
+    tracers->residency.resident = false;
+    tracers->seeded = false;
+}
+
+void tracers_reseed(Tracers *tracers) {
+    tracers->seeded = false;
+}
+
+// the barycenter is reduced once in its own pass so it's complete before any tracer is seeded around it
+static void tracers_barycenter(const Tracers *tracers, const TracersUpdateInfo *info) {
+    const SimulationFrame *sim = info->sim;
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(info->command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = tracers->barycenter, .cycle = false },
+    }, 1);
+
+    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &sim->body_count, sizeof(sim->body_count));
+    kernel_bind(&tracers->barycenter_kernel, compute_pass, sim->body_count);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        tracers->barycenter,
+        sim->positions.buffer,
+        sim->velocities.buffer,
+        sim->masses.buffer
+    }, 4);
+    SDL_DispatchGPUCompute(compute_pass, 1, 1, 1);
+    SDL_EndGPUComputePass(compute_pass);
+}
+
+// tracers start on circular orbits around the bodies' barycenter, spread evenly over a disk
+static void tracers_seed(Tracers *tracers, const TracersUpdateInfo *info) {
+    const SimulationFrame *sim = info->sim;
+    tracers->count = (u32) SDL_clamp(tracers->options.count, 1, TRACER_COUNT_MAX);
+    tracers->seed++;
+    ReserveGPUArray(&tracers->positions, info->gpu, tracers->count * sizeof(HMM_Vec2));
+    ReserveGPUArray(&tracers->velocities, info->gpu, tracers->count * sizeof(HMM_Vec2));
+    tracers_barycenter(tracers, info);
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(info->command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = tracers->positions.buffer, .cycle = false },
+        { .buffer = tracers->velocities.buffer, .cycle = false },
+    }, 2);
+
+    const struct {
+        u32 tracer_count;
+        f32 G;
+        f32 radius;
+        u32 seed;
+    } constants = {
+        tracers->count,
+        sim->options.gravity,
+        tracers->options.radius,
+        tracers->seed
+    };
+    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &constants, sizeof(constants));
+
+    const u32 groups = kernel_bind(&tracers->seed_kernel, compute_pass, tracers->count);
+    const u32 groups_x = SDL_min(groups, MAX_WORKGROUP_COUNT);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        tracers->positions.buffer,
+        tracers->velocities.buffer,
+        tracers->barycenter
+    }, 3);
+    SDL_DispatchGPUCompute(compute_pass, groups_x, (groups + groups_x - 1) / groups_x, 1);
+    SDL_EndGPUComputePass(compute_pass);
+
+    tracers->step = sim->step;
+    tracers->seeded = true;
+}
+
+void tracers_update(Tracers *tracers, const TracersUpdateInfo *info) {
+    const SimulationFrame *sim = info->sim;
+    if (GPUResidencyExpired(&tracers->residency, tracers->options.enabled, RELEASE_DELAY)) tracers_release(tracers, info->gpu);
+    if (!tracers->options.enabled || !sim->body_count) return;
+    if (!tracers->residency.resident && tracers_load(tracers, info->gpu) != SDL_APP_CONTINUE) {
+        tracers->options.enabled = false;
+        return;
+    }
+
+    if (!tracers->seeded || tracers->count != (u32) SDL_clamp(tracers->options.count, 1, TRACER_COUNT_MAX)) {
+        tracers_seed(tracers, info);
+        return;
+    }
+
+    // tracers follow the simulation step for step against the latest bodies, in slices of whatever the budget
+    // leaves over. steps that don't fit are carried to the next frame, only a backlog the tracers could never
+    // catch up on is skipped. a simulation that's been reset starts counting again from where it is now
+    if (sim->step < tracers->step) tracers->step = sim->step;
+    if (sim->step - tracers->step > TRACER_MAX_BACKLOG) tracers->step = sim->step - TRACER_MAX_BACKLOG;
+    const u32 backlog = (u32) (sim->step - tracers->step);
+    if (!backlog) return;
+    const u32 steps = scheduler_plan_units(info->scheduler, SCHEDULER_WORK_TRACERS, backlog);
+    tracers->step += steps;
+
+    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(info->gpu);
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = tracers->positions.buffer, .cycle = false },
+        { .buffer = tracers->velocities.buffer, .cycle = false },
+    }, 2);
+
+    const struct {
+        u32 tracer_count;
+        u32 body_count;
+        f32 G;
+        f32 ee;
+        f32 delta_time;
+        u32 steps;
+    } constants = {
+        tracers->count,
+        sim->body_count,
+        sim->options.gravity,
+        sim->options.softening,
+        sim->delta_time,
+        steps
+    };
+    SDL_PushGPUComputeUniformData(command_buffer, 0, &constants, sizeof(constants));
+
+    const u32 groups = kernel_bind(&tracers->kernel, compute_pass, tracers->count);
+    const u32 groups_x = SDL_min(groups, MAX_WORKGROUP_COUNT);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        tracers->positions.buffer,
+        tracers->velocities.buffer,
+        sim->positions.buffer,
+        sim->masses.buffer
+    }, 4);
+    SDL_DispatchGPUCompute(compute_pass, groups_x, (groups + groups_x - 1) / groups_x, 1);
+    SDL_EndGPUComputePass(compute_pass);
+    scheduler_submit(info->scheduler, info->gpu, command_buffer, SCHEDULER_WORK_TRACERS, steps);
+}
+
+void tracers_free(Tracers *tracers, SDL_GPUDevice *gpu) {
+    if (tracers->residency.resident) tracers_release(tracers, gpu);
+    if (tracers->residency.loaded) {
+        kernel_free(&tracers->kernel, gpu);
+        kernel_free(&tracers->seed_kernel, gpu);
+        kernel_free(&tracers->barycenter_kernel, gpu);
+    }
+}
@@ -2,39 +2,214 @@
 #include "constants.h"
 #include "simulation.h"
 
-#define TRAIL_SIZE sizeof(HMM_Vec2) * TRAIL_LENGTH
+#include "stb_ds.h"
 
-SDL_AppResult trails_init(Trails *trails, SDL_GPUDevice *gpu) {
-    trails->pipeline = CreateGPUComputePipeline(gpu, "shaders/trail.comp.spv");
-    if (!trails->pipeline) panic("Could not create trails pipeline!");
+#define TRAIL_SIZE sizeof(u32) * TRAIL_LENGTH
 
-    trails->array = CreateGPUArray(gpu, TRAIL_SIZE, SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+void trails_init(Trails *trails) {
+    trails->selection = (Selection) { 0 };
+    trails->requests = NULL;
+    trails->options = (TrailOptions) { .enabled = true, .sample_steps = TRAIL_SAMPLE_STEPS_DEFAULT };
+    trails->residency = (GPUResidency) { 0 };
+}
+
+// one dispatch covers every trail, either adding the samples that are due or filling whole trails from scratch
+static void trails_dispatch(const Trails *trails, const TrailsUpdateInfo *info, const u32 samples, const bool fill) {
+    const SimulationFrame *sim = info->sim;
+    const u32 count = selection_count(&trails->selection);
+    const u64 interval = (u64) SDL_clamp(trails->options.sample_steps, 1, TRAIL_SAMPLE_STEPS_MAX);
+    const u64 first = trails->step - (u64) (samples ? samples - 1 : 0) * interval;
+    const i64 first_row = (i64) first - (i64) sim->history_step;
+    const struct {
+        u32 frame;
+        u32 samples;
+        u32 body_count;
+        u32 count;
+        u32 fill;
+        i32 first_row;
+        u32 interval;
+        u32 history_count;
+    } constants = {
+        trails->frame, samples, sim->body_count, count, fill,
+        // past either end every sample misses the history, so the row only has to fit
+        (i32) SDL_clamp(first_row, -(i64) (samples * interval) - 1, (i64) sim->history_count),
+        (u32) interval,
+        sim->history_count
+    };
+
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(info->command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = trails->array.buffer, .cycle = false },
+        { .buffer = trails->anchors.buffer, .cycle = false }
+    }, 2);
+    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &constants, sizeof(constants));
+    const u32 groups = kernel_bind(&trails->kernel, compute_pass, count);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        trails->array.buffer,
+        trails->anchors.buffer,
+        trails->bodies.buffer,
+        sim->positions.buffer,
+        // never read without any history
+        sim->history_count ? sim->history.buffer : sim->positions.buffer
+    }, 5);
+    SDL_DispatchGPUCompute(compute_pass, groups, 1, 1);
+    SDL_EndGPUComputePass(compute_pass);
+}
+
+// every selected body's trail starts out where the body is now, so bodies added while the trails were released
+// are caught up along with the rest
+static SDL_AppResult trails_load(Trails *trails, const TrailsUpdateInfo *info) {
+    const u32 count = selection_count(&trails->selection);
+    if (!trails->residency.loaded) {
+        if (!kernel_init(&trails->kernel, info->gpu, "shaders/trail.comp")) panic("Could not create trails pipeline!");
+        trails->residency.loaded = true;
+    }
+
+    trails->array = CreateGPUArray(info->gpu, SDL_max(count, 1) * TRAIL_SIZE, SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    trails->anchors = CreateGPUArray(info->gpu, SDL_max(count, 1) * sizeof(TrailAnchor), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    trails->bodies = CreateGPUArray(info->gpu, SDL_max(count, 1) * sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
     if (!trails->array.buffer) panic("Could not create trails array!");
+    if (!trails->anchors.buffer) panic("Could not create trail anchors array!");
+    if (!trails->bodies.buffer) panic("Could not create trail bodies array!");
+    trails->array.used = count * TRAIL_SIZE;
+    trails->anchors.used = count * sizeof(TrailAnchor);
+    trails->bodies.used = count * sizeof(u32);
+    trails->residency.resident = true;
+    trails->step = info->sim->step;
+    if (!count) return SDL_APP_CONTINUE;
+
+    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(info->command_buffer);
+    WriteToGPUBuffers(info->gpu, copy_pass, &(WriteGPUBufferBinding) {
+        .buffer = trails->bodies.buffer,
+        .source = (u8*) trails->selection.bodies,
+        .size = count * sizeof(u32)
+    }, 1);
+    SDL_EndGPUCopyPass(copy_pass);
+
+    trails_dispatch(trails, info, 0, true);
     return SDL_APP_CONTINUE;
 }
 
-void trails_add_body(Trails *trails, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass, const HMM_Vec2 position) {
-    HMM_Vec2 trail[TRAIL_LENGTH];
-    for (usize i = 0; i < TRAIL_LENGTH; i++) trail[i] = position;
+static void trails_release(Trails *trails, SDL_GPUDevice *gpu) {
+    SDL_ReleaseGPUBuffer(gpu, trails->array.buffer);
+    SDL_ReleaseGPUBuffer(gpu, trails->anchors.buffer);
+    SDL_ReleaseGPUBuffer(gpu, trails->bodies.buffer);
+    trails->array = (GPUArray) { 0 };
+    trails->anchors = (GPUArray) { 0 };
+    trails->bodies = (GPUArray) { 0 };
+    trails->residency.resident = false;
+}
+
+static void trails_append(Trails *trails, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass, const u32 body, const HMM_Vec2 position) {
+    // every point sits right on the anchor, which packs to zero
+    const u32 trail[TRAIL_LENGTH] = { 0 };
+    const TrailAnchor anchor = { .origin = position, .extent = TRAIL_EXTENT_MIN };
 
-    AppendGPUArrays(gpu, copy_pass, &(AppendGPUArrayBinding) {
-        .array = &trails->array,
-        .source = (u8 *) &trail,
-        .size = TRAIL_SIZE
-    }, 1);
+    AppendGPUArrays(gpu, copy_pass, (AppendGPUArrayBinding[]) {
+        { .array = &trails->array, .source = (u8 *) &trail, .size = TRAIL_SIZE },
+        { .array = &trails->anchors, .source = (u8 *) &anchor, .size = sizeof(TrailAnchor) },
+        { .array = &trails->bodies, .source = (u8 *) &body, .size = sizeof(u32) }
+    }, 3);
 }
 
-void trails_update(Trails *trails, SDL_GPUCommandBuffer *command_buffer, SDL_GPUComputePass *compute_pass, const Simulation *sim) {
-    if (sim->options.paused || !sim->body_count) return;
-    trails->frame = (trails->frame + 1) % TRAIL_LENGTH;
-    SDL_PushGPUComputeUniformData(command_buffer, 0, &trails->frame, sizeof(u32));
+// the last trail is moved into the gap so every dispatch still covers a dense range of slots
+static void trails_remove(Trails *trails, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass, const u32 body) {
+    const u32 slot = selection_remove(&trails->selection, body);
+    const u32 last = selection_count(&trails->selection);
+    if (slot != last) {
+        SDL_CopyGPUBufferToBuffer(copy_pass, &(SDL_GPUBufferLocation) {
+            .buffer = trails->array.buffer,
+            .offset = last * TRAIL_SIZE
+        }, &(SDL_GPUBufferLocation) {
+            .buffer = trails->array.buffer,
+            .offset = slot * TRAIL_SIZE
+        }, TRAIL_SIZE, false);
+        SDL_CopyGPUBufferToBuffer(copy_pass, &(SDL_GPUBufferLocation) {
+            .buffer = trails->anchors.buffer,
+            .offset = last * sizeof(TrailAnchor)
+        }, &(SDL_GPUBufferLocation) {
+            .buffer = trails->anchors.buffer,
+            .offset = slot * sizeof(TrailAnchor)
+        }, sizeof(TrailAnchor), false);
+        WriteToGPUBuffers(gpu, copy_pass, &(WriteGPUBufferBinding) {
+            .buffer = trails->bodies.buffer,
+            .buffer_offset = slot * sizeof(u32),
+            .source = (u8*) &trails->selection.bodies[slot],
+            .size = sizeof(u32)
+        }, 1);
+    }
 
-    SDL_BindGPUComputePipeline(compute_pass, trails->pipeline);
-    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) { trails->array.buffer, sim->positions_a.buffer }, 2);
-    SDL_DispatchGPUCompute(compute_pass, sim->body_count, 1, 1);
+    trails->array.used -= TRAIL_SIZE;
+    trails->anchors.used -= sizeof(TrailAnchor);
+    trails->bodies.used -= sizeof(u32);
 }
 
-void trails_free(const Trails *trails, SDL_GPUDevice *gpu) {
-    SDL_ReleaseGPUBuffer(gpu, trails->array.buffer);
-    SDL_ReleaseGPUComputePipeline(gpu, trails->pipeline);
+void trails_add_body(
+    Trails *trails,
+    SDL_GPUDevice *gpu,
+    SDL_GPUCopyPass *copy_pass,
+    const HMM_Vec2 position,
+    const bool selected
+) {
+    const u32 body = (u32) arrlen(trails->selection.slots);
+    selection_add_body(&trails->selection, selected);
+    if (selected && trails->residency.resident) trails_append(trails, gpu, copy_pass, body, position);
+}
+
+void trails_select(Trails *trails, const u32 body, const HMM_Vec2 position, const bool selected) {
+    arrput(trails->requests, ((TrailsRequest) { .position = position, .body = body, .selected = selected }));
+}
+
+// while released only the selection changes, the trails are rebuilt from it once they're loaded again
+static void trails_requests(Trails *trails, const TrailsUpdateInfo *info) {
+    if (!arrlen(trails->requests)) return;
+    const bool resident = trails->residency.resident;
+    SDL_GPUCopyPass *copy_pass = resident ? SDL_BeginGPUCopyPass(info->command_buffer) : NULL;
+    for (i32 i = 0; i < arrlen(trails->requests); i++) {
+        const TrailsRequest *request = &trails->requests[i];
+        if (selection_contains(&trails->selection, request->body) == request->selected) continue;
+        if (!request->selected) {
+            if (resident) trails_remove(trails, info->gpu, copy_pass, request->body);
+            else selection_remove(&trails->selection, request->body);
+        } else {
+            selection_insert(&trails->selection, request->body);
+            if (resident) trails_append(trails, info->gpu, copy_pass, request->body, request->position);
+        }
+    }
+
+    if (copy_pass) SDL_EndGPUCopyPass(copy_pass);
+    arrfree(trails->requests);
+}
+
+void trails_update(Trails *trails, const TrailsUpdateInfo *info) {
+    const SimulationFrame *sim = info->sim;
+    if (GPUResidencyExpired(&trails->residency, trails->options.enabled, RELEASE_DELAY)) trails_release(trails, info->gpu);
+    trails_requests(trails, info);
+
+    // bodies are filled in from the simulation, so loading waits until it has caught up with every one of them
+    if (!trails->residency.resident) {
+        if (!trails->options.enabled || arrlen(trails->selection.slots) > sim->body_count) return;
+        if (trails_load(trails, info) != SDL_APP_CONTINUE) {
+            trails->options.enabled = false;
+            return;
+        }
+    }
+
+    // points are spaced in simulation steps rather than frames, so a trail covers the same stretch of simulated
+    // time whatever the frame rate. a simulation that's been reset starts counting again from where it is now
+    if (sim->step < trails->step) trails->step = sim->step;
+    const u64 interval = (u64) SDL_clamp(trails->options.sample_steps, 1, TRAIL_SAMPLE_STEPS_MAX);
+    const u64 due = (sim->step - trails->step) / interval;
+    trails->step += due * interval;
+    if (!due || !sim->body_count || !selection_count(&trails->selection)) return;
+
+    const u32 samples = (u32) SDL_min(due, TRAIL_LENGTH);
+    trails->frame = (trails->frame + samples) % TRAIL_LENGTH;
+    trails_dispatch(trails, info, samples, false);
+}
+
+void trails_free(Trails *trails, SDL_GPUDevice *gpu) {
+    if (trails->residency.resident) trails_release(trails, gpu);
+    if (trails->residency.loaded) kernel_free(&trails->kernel, gpu);
+    selection_free(&trails->selection);
+    arrfree(trails->requests);
 }
@@ -3,99 +3,476 @@
 #include "constants.h"
 #include "simulation.h"
 #include "ghost.h"
+#include "scheduler.h"
 
 #include "HandmadeMath.h"
+#include "stb_ds.h"
 
 #define PREDICTION_SIZE sizeof(HMM_Vec2) * PREDICTION_LENGTH
+#define PREDICTION_TIMES_SIZE sizeof(f32) * PREDICTION_LENGTH
 
-SDL_AppResult trajectories_init(Trajectories *trajectories, SDL_GPUDevice *gpu) {
-    trajectories->pipeline = CreateGPUComputePipeline(gpu, "shaders/trajectory.comp.spv");
-    if (!trajectories->pipeline) panic("Failed to create trajectories compute pipeline!");
+static SDL_AppResult trajectory_buffers_init(TrajectoryBuffers *buffers, SDL_GPUDevice *gpu) {
+    buffers->positions = CreateGPUArray(gpu, PREDICTION_SIZE, SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    buffers->times = CreateGPUArray(gpu, PREDICTION_TIMES_SIZE, SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    buffers->vertex_counts = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    buffers->bodies = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    buffers->slots = NULL;
+    if (!buffers->positions.buffer) panic("Failed to create trajectory positions buffer!");
+    if (!buffers->times.buffer) panic("Failed to create trajectory times buffer!");
+    if (!buffers->vertex_counts.buffer) panic("Failed to create trajectory vertex counts buffer!");
+    if (!buffers->bodies.buffer) panic("Failed to create trajectory bodies buffer!");
+    return SDL_APP_CONTINUE;
+}
 
-    trajectories->positions = CreateGPUArray(gpu, PREDICTION_SIZE, SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
-    trajectories->velocities = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
-    if (!trajectories->positions.buffer) panic("Failed to create trajectory positions buffer!");
-    if (!trajectories->velocities.buffer) panic("Failed to create trajectory velocities buffer!");
+// every job starts over, so the pending buffers only ever need room for the slots it keeps
+static void trajectory_buffers_reserve(TrajectoryBuffers *buffers, SDL_GPUDevice *gpu, const u32 slot_count) {
+    ReserveGPUArray(&buffers->positions, gpu, slot_count * PREDICTION_SIZE);
+    ReserveGPUArray(&buffers->times, gpu, slot_count * PREDICTION_TIMES_SIZE);
+    ReserveGPUArray(&buffers->vertex_counts, gpu, slot_count * sizeof(u32));
+    ReserveGPUArray(&buffers->bodies, gpu, slot_count * sizeof(u32));
+}
 
+static void trajectory_buffers_free(TrajectoryBuffers *buffers, SDL_GPUDevice *gpu) {
+    SDL_ReleaseGPUBuffer(gpu, buffers->positions.buffer);
+    SDL_ReleaseGPUBuffer(gpu, buffers->times.buffer);
+    SDL_ReleaseGPUBuffer(gpu, buffers->vertex_counts.buffer);
+    SDL_ReleaseGPUBuffer(gpu, buffers->bodies.buffer);
+    arrfree(buffers->slots);
+}
+
+void trajectories_init(Trajectories *trajectories) {
     trajectories->options = (TrajectoryOptions) {
+        .horizon = TRAJECTORY_HORIZON_DEFAULT,
+        .sample_distance = TRAJECTORY_SAMPLE_DISTANCE_DEFAULT,
         .delta_time_multiplier = TRAJECTORY_DELTA_TIME_MULTIPLIER_DEFAULT,
+        .ghost_ephemeris = TRAJECTORY_GHOST_EPHEMERIS_DEFAULT,
         .enabled = true
     };
+    trajectories->computed = (TrajectoriesState) { .valid = false };
+    trajectories->ghost = (TrajectoriesGhostState) { .valid = false };
+    trajectories->drawn = (TrajectoriesDrawn) { .valid = false };
+    trajectories->selection = (Selection) { 0 };
+    trajectories->residency = (GPUResidency) { 0 };
+    trajectories->generation = 0;
+    trajectories->busy = false;
+}
+
+// buffers start out empty, every job sizes them to what it keeps, so nothing needs catching up after a release
+static SDL_AppResult trajectories_load(Trajectories *trajectories, SDL_GPUDevice *gpu) {
+    if (!trajectories->residency.loaded) {
+        if (!kernel_init(&trajectories->kernel, gpu, "shaders/trajectory.comp")) panic("Failed to create trajectories compute pipeline!");
+        if (!kernel_init(&trajectories->ghost_kernel, gpu, "shaders/trajectory_ghost.comp")) panic("Failed to create ghost trajectory compute pipeline!");
+        trajectories->residency.loaded = true;
+    }
 
+    if (trajectory_buffers_init(&trajectories->predicted, gpu) != 0) return SDL_APP_FAILURE;
+    if (trajectory_buffers_init(&trajectories->pending, gpu) != 0) return SDL_APP_FAILURE;
+    trajectories->velocities = CreateGPUArray(gpu, sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    trajectories->state = CreateGPUArray(gpu, 2 * sizeof(HMM_Vec2), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    trajectories->samples = CreateGPUArray(gpu, sizeof(HMM_Vec4), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    trajectories->cursors = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    trajectories->slots = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    trajectories->ghost_state = CreateGPUArray(gpu, 3 * sizeof(HMM_Vec4), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    trajectories->drawn_slots = CreateGPUArray(gpu, sizeof(u32), SDL_GPU_BUFFERUSAGE_READWRITEDRAW);
+    if (!trajectories->velocities.buffer) panic("Failed to create trajectory velocities buffer!");
+    if (!trajectories->state.buffer) panic("Failed to create trajectory state buffer!");
+    if (!trajectories->samples.buffer) panic("Failed to create trajectory samples buffer!");
+    if (!trajectories->cursors.buffer) panic("Failed to create trajectory cursors buffer!");
+    if (!trajectories->slots.buffer) panic("Failed to create trajectory slots buffer!");
+    if (!trajectories->ghost_state.buffer) panic("Failed to create ghost trajectory state buffer!");
+    if (!trajectories->drawn_slots.buffer) panic("Failed to create drawn trajectory slots buffer!");
+    trajectories->residency.resident = true;
     return SDL_APP_CONTINUE;
 }
 
-void trajectories_add_body(Trajectories *trajectories, SDL_GPUDevice *gpu, SDL_GPUCopyPass *copy_pass) {
-    ExpandGPUArray(&trajectories->positions, gpu, copy_pass, PREDICTION_SIZE);
-    ExpandGPUArray(&trajectories->velocities, gpu, copy_pass, sizeof(HMM_Vec2));
-    trajectories->positions.used += PREDICTION_SIZE;
-    trajectories->velocities.used += sizeof(HMM_Vec2);
+// whatever was predicted or half predicted goes with the buffers
+static void trajectories_release(Trajectories *trajectories, SDL_GPUDevice *gpu) {
+    trajectory_buffers_free(&trajectories->predicted, gpu);
+    trajectory_buffers_free(&trajectories->pending, gpu);
+    SDL_ReleaseGPUBuffer(gpu, trajectories->velocities.buffer);
+    SDL_ReleaseGPUBuffer(gpu, trajectories->state.buffer);
+    SDL_ReleaseGPUBuffer(gpu, trajectories->samples.buffer);
+    SDL_ReleaseGPUBuffer(gpu, trajectories->cursors.buffer);
+    SDL_ReleaseGPUBuffer(gpu, trajectories->slots.buffer);
+    SDL_ReleaseGPUBuffer(gpu, trajectories->ghost_state.buffer);
+    SDL_ReleaseGPUBuffer(gpu, trajectories->drawn_slots.buffer);
+    trajectories->computed = (TrajectoriesState) { .valid = false };
+    trajectories->ghost = (TrajectoriesGhostState) { .valid = false };
+    trajectories->drawn = (TrajectoriesDrawn) { .valid = false };
+    trajectories->residency.resident = false;
+    trajectories->busy = false;
+}
+
+void trajectories_add_body(Trajectories *trajectories, const bool selected) {
+    selection_add_body(&trajectories->selection, selected);
+}
+
+// takes effect with the next job, which the selection changing starts. while every body is predicted for the
+// ghost it's only which of them are drawn that changes
+void trajectories_select(Trajectories *trajectories, const u32 body, const bool selected) {
+    if (selected) selection_insert(&trajectories->selection, body);
+    else selection_remove(&trajectories->selection, body);
+}
+
+static TrajectoriesState trajectories_state(const Trajectories *trajectories, const TrajectoriesUpdateInfo *info) {
+    const SimulationFrame *sim = info->sim;
+    const Ghost *ghost = info->ghost;
+    const f32 delta_time = info->delta_time;
+
+    // the ghost predicted on its own flies through every body's prediction, so none of them can be left out
+    const bool all = ghost->enabled && trajectories->options.ghost_ephemeris;
+    const bool followed = info->target < sim->body_count && !all && !selection_contains(&trajectories->selection, info->target);
+    return (TrajectoriesState) {
+        .sim_version = sim->version,
+        .options = trajectories->options,
+        .ghost_position = ghost->position,
+        .ghost_velocity = ghost->velocity,
+        .ghost_mass = ghost->mass,
+        .delta_time = delta_time,
+        .gravity = sim->options.gravity,
+        .softening = sim->options.softening,
+        .selection_version = trajectories->selection.version,
+        .body_count = sim->body_count,
+        .target = followed ? info->target : SELECTION_NONE,
+        .horizon = (u32) SDL_clamp(trajectories->options.horizon, 1, TRAJECTORY_HORIZON_MAX),
+        .ghost = ghost->enabled && !trajectories->options.ghost_ephemeris,
+        .all = all,
+        .valid = true
+    };
+}
+
+static bool trajectories_dirty(const Trajectories *trajectories, const TrajectoriesUpdateInfo *info) {
+    const TrajectoriesState *a = &trajectories->computed;
+    const TrajectoriesState b = trajectories_state(trajectories, info);
+    return !a->valid
+        || a->sim_version != b.sim_version
+        || a->target != b.target
+        || a->all != b.all
+        || (!b.all && a->selection_version != b.selection_version)
+        || a->options.delta_time_multiplier != b.options.delta_time_multiplier
+        || a->options.horizon != b.options.horizon
+        || a->options.sample_distance != b.options.sample_distance
+        || a->options.enabled != b.options.enabled
+        || a->options.ghost_ephemeris != b.options.ghost_ephemeris
+        || a->ghost != b.ghost
+        || a->delta_time != b.delta_time
+        || (b.ghost && (
+            a->ghost_position.X != b.ghost_position.X || a->ghost_position.Y != b.ghost_position.Y
+            || a->ghost_velocity.X != b.ghost_velocity.X || a->ghost_velocity.Y != b.ghost_velocity.Y
+            || a->ghost_mass != b.ghost_mass
+        ));
+}
+
+u32 trajectories_steps(const TrajectoriesState *state) {
+    return state->horizon + 1;
 }
 
-void trajectories_ghost_update(const Trajectories *trajectories, const TrajectoriesGhostUpdateInfo *info) {
-    if (!info->ghost->enabled) return;
-    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(info->command_buffer);
+static void trajectories_begin(Trajectories *trajectories, const TrajectoriesUpdateInfo *info, SDL_GPUCommandBuffer *command_buffer) {
+    TrajectoriesState *job = &trajectories->computing;
+    *job = trajectories_state(trajectories, info);
+    trajectories->progress = 0;
+    trajectories->busy = true;
+
+    // slots are handed out in body order, so with every body kept they're the same as the bodies' own indices
+    TrajectoryBuffers *pending = &trajectories->pending;
+    u32 *bodies = NULL;
+    arrsetlen(pending->slots, job->body_count);
+    for (u32 i = 0; i < job->body_count; i++) {
+        const bool kept = job->all || i == job->target || selection_contains(&trajectories->selection, i);
+        pending->slots[i] = kept ? (u32) arrlen(bodies) : SELECTION_NONE;
+        if (kept) arrput(bodies, i);
+    }
+    job->count = (u32) arrlen(bodies);
+    arrput(bodies, SELECTION_NONE);
+
+    const u32 body_count = job->body_count;
+    trajectory_buffers_reserve(pending, info->gpu, job->count + 1);
+    ReserveGPUArray(&trajectories->slots, info->gpu, SDL_max(body_count, 1) * sizeof(u32));
+    ReserveGPUArray(&trajectories->velocities, info->gpu, (body_count + 1) * sizeof(HMM_Vec2));
+    ReserveGPUArray(&trajectories->state, info->gpu, 2 * (body_count + 1) * sizeof(HMM_Vec2));
+    ReserveGPUArray(&trajectories->samples, info->gpu, (body_count + 1) * sizeof(HMM_Vec4));
+
+    // the ghost isn't part of the simulation, so its starting point is written in directly
+    SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(command_buffer);
     WriteToGPUBuffers(info->gpu, copy_pass, (WriteGPUBufferBinding[]) {
         {
-            .buffer = trajectories->positions.buffer,
-            .buffer_offset = info->sim->body_count * PREDICTION_SIZE,
+            .buffer = pending->bodies.buffer,
+            .source = (u8*) bodies,
+            .size = (job->count + 1) * sizeof(u32)
+        },
+        {
+            .buffer = trajectories->slots.buffer,
+            .source = (u8*) pending->slots,
+            .size = body_count * sizeof(u32)
+        },
+        {
+            .buffer = trajectories->state.buffer,
+            .buffer_offset = body_count * sizeof(HMM_Vec2),
             .source = (u8*) &info->ghost->position,
             .size = sizeof(HMM_Vec2)
         },
         {
             .buffer = trajectories->velocities.buffer,
-            .buffer_offset = info->sim->body_count * sizeof(HMM_Vec2),
+            .buffer_offset = body_count * sizeof(HMM_Vec2),
             .source = (u8*) &info->ghost->velocity,
             .size = sizeof(HMM_Vec2)
         }
-    }, 2);
+    }, job->ghost ? 4 : 2);
     SDL_EndGPUCopyPass(copy_pass);
+    arrfree(bodies);
 }
 
-void trajectories_update(const Trajectories *trajectories, TrajectoriesUpdateInfo *info) {
-    if (!trajectories->options.enabled) return;
-    u32 trajectory_count = info->sim->body_count;
-    if (info->ghost->enabled) trajectory_count += 1;
-    if (!trajectory_count) return;
+static void trajectories_step(Trajectories *trajectories, const TrajectoriesUpdateInfo *info) {
+    // a new body takes over the ghost's slot, so a job started before it was added can't be finished
+    if (trajectories->busy && trajectories->computing.body_count != info->sim->body_count) trajectories->busy = false;
+    if (!trajectories->busy) {
+        if (!trajectories_dirty(trajectories, info)) return;
+
+        // with nothing to keep there's nothing to wait for, a ghost predicted on its own just flies straight
+        const TrajectoriesState state = trajectories_state(trajectories, info);
+        const bool keeping = state.all || state.target != SELECTION_NONE || selection_count(&trajectories->selection);
+        if (!state.ghost && (!state.body_count || !keeping)) {
+            trajectories->computed = state;
+            trajectories->generation++;
+            return;
+        }
+    }
+
+    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(info->gpu);
+    if (!trajectories->busy) trajectories_begin(trajectories, info, command_buffer);
 
-    SDL_BindGPUComputePipeline(info->compute_pass, trajectories->pipeline);
+    // jobs run to completion against the state they started from, later changes wait for the next job
+    const TrajectoriesState *job = &trajectories->computing;
+    const u32 integrated_count = job->body_count + (job->ghost ? 1 : 0);
+    const u32 steps = trajectories_steps(job);
+    const u32 frames = scheduler_plan_units(info->scheduler, SCHEDULER_WORK_TRAJECTORIES, steps - trajectories->progress);
+
+    const TrajectoryBuffers *pending = &trajectories->pending;
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = pending->positions.buffer, .cycle = false },
+        { .buffer = pending->times.buffer, .cycle = false },
+        { .buffer = pending->vertex_counts.buffer, .cycle = false },
+        { .buffer = trajectories->velocities.buffer, .cycle = false },
+        { .buffer = trajectories->state.buffer, .cycle = false },
+        { .buffer = trajectories->samples.buffer, .cycle = false },
+    }, 6);
+    const u32 groups = kernel_bind(&trajectories->kernel, compute_pass, integrated_count);
 
     const struct {
-        u32 count;
+        u32 body_count;
         f32 gravity;
         f32 softening;
         f32 delta_time;
         f32 ghost_mass;
-        bool ghost;
+        u32 ghost;
+        u32 steps;
+        f32 sample_distance;
+        u32 count;
     } constants = {
-        info->sim->body_count,
-        info->sim->options.gravity,
-        info->sim->options.softening,
-        info->delta_time * trajectories->options.delta_time_multiplier,
-        info->ghost->mass,
-        info->ghost->enabled
+        job->body_count,
+        job->gravity,
+        job->softening,
+        job->delta_time * job->options.delta_time_multiplier,
+        job->ghost_mass,
+        job->ghost,
+        steps,
+        job->options.sample_distance,
+        job->count
     };
-    SDL_PushGPUComputeUniformData(info->command_buffer, 0, &constants, sizeof(constants));
+    SDL_PushGPUComputeUniformData(command_buffer, 0, &constants, sizeof(constants));
 
-    SDL_BindGPUComputeStorageBuffers(info->compute_pass, 0, (SDL_GPUBuffer*[]) {
-        trajectories->positions.buffer,
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        pending->positions.buffer,
+        pending->times.buffer,
+        pending->vertex_counts.buffer,
         trajectories->velocities.buffer,
-        info->sim->current_buffer == SIM_POSITIONS_A
-            ? info->sim->positions_b.buffer
-            : info->sim->positions_a.buffer,
+        trajectories->state.buffer,
+        trajectories->samples.buffer,
+        info->sim->positions.buffer,
         info->sim->velocities.buffer,
         info->sim->masses.buffer,
-        info->sim->movable.buffer
+        trajectories->slots.buffer
+    }, 10);
+
+    for (u32 i = trajectories->progress; i < trajectories->progress + frames; i++) {
+        SDL_PushGPUComputeUniformData(command_buffer, 1, &i, sizeof(i));
+        SDL_DispatchGPUCompute(compute_pass, groups, 1, 1);
+    }
+
+    SDL_EndGPUComputePass(compute_pass);
+    scheduler_submit(info->scheduler, info->gpu, command_buffer, SCHEDULER_WORK_TRAJECTORIES, frames);
+
+    trajectories->progress += frames;
+    if (trajectories->progress < steps) return;
+    const TrajectoryBuffers finished = trajectories->pending;
+    trajectories->pending = trajectories->predicted;
+    trajectories->predicted = finished;
+    trajectories->computed = trajectories->computing;
+    trajectories->generation++;
+    trajectories->busy = false;
+}
+
+// with the ghost too light to disturb anything, the bodies' predictions are reused as an ephemeris and only the
+// ghost is integrated through them, O(N) per step instead of O(N^2), so dragging it doesn't restart the job above.
+// its steps are still serial, so they're sliced through the scheduler rather than walked all at once
+static void trajectories_ghost_update(Trajectories *trajectories, const TrajectoriesUpdateInfo *info) {
+    const TrajectoriesState *computed = &trajectories->computed;
+    if (!computed->valid || !computed->all || !info->ghost->enabled) {
+        trajectories->ghost.valid = false;
+        return;
+    }
+
+    const TrajectoriesGhostState state = {
+        .position = info->ghost->position,
+        .velocity = info->ghost->velocity,
+        .generation = trajectories->generation,
+        .progress = 0,
+        .valid = true
+    };
+    const TrajectoriesGhostState *previous = &trajectories->ghost;
+    const bool changed = !previous->valid
+        || previous->generation != state.generation
+        || previous->position.X != state.position.X || previous->position.Y != state.position.Y
+        || previous->velocity.X != state.velocity.X || previous->velocity.Y != state.velocity.Y;
+    if (changed) trajectories->ghost = state;
+
+    const u32 steps = trajectories_steps(computed);
+    const u32 progress = trajectories->ghost.progress;
+    if (progress >= steps) return;
+    const u32 units = scheduler_plan_units(info->scheduler, SCHEDULER_WORK_GHOST, steps - progress);
+
+    const TrajectoryBuffers *predicted = &trajectories->predicted;
+    if (!progress) ReserveGPUArray(&trajectories->cursors, info->gpu, SDL_max(computed->body_count, 1) * sizeof(u32));
+    SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(info->gpu);
+    SDL_GPUComputePass *compute_pass = SDL_BeginGPUComputePass(command_buffer, NULL, 0, (SDL_GPUStorageBufferReadWriteBinding[]) {
+        { .buffer = predicted->positions.buffer, .cycle = false },
+        { .buffer = predicted->times.buffer, .cycle = false },
+        { .buffer = predicted->vertex_counts.buffer, .cycle = false },
+        { .buffer = trajectories->cursors.buffer, .cycle = false },
+        { .buffer = trajectories->ghost_state.buffer, .cycle = false },
+    }, 5);
+
+    const struct {
+        HMM_Vec2 position;
+        HMM_Vec2 velocity;
+        u32 count;
+        f32 gravity;
+        f32 softening;
+        f32 delta_time;
+        u32 steps;
+        f32 sample_distance;
+        u32 begin;
+        u32 end;
+    } constants = {
+        state.position,
+        state.velocity,
+        computed->body_count,
+        computed->gravity,
+        computed->softening,
+        computed->delta_time * computed->options.delta_time_multiplier,
+        steps,
+        computed->options.sample_distance,
+        progress,
+        progress + units
+    };
+    SDL_PushGPUComputeUniformData(command_buffer, 0, &constants, sizeof(constants));
+
+    // a single workgroup, the widest that the bodies can keep busy
+    kernel_bind(&trajectories->ghost_kernel, compute_pass, computed->body_count);
+    SDL_BindGPUComputeStorageBuffers(compute_pass, 0, (SDL_GPUBuffer*[]) {
+        predicted->positions.buffer,
+        predicted->times.buffer,
+        predicted->vertex_counts.buffer,
+        info->sim->masses.buffer,
+        trajectories->cursors.buffer,
+        trajectories->ghost_state.buffer
     }, 6);
+    SDL_DispatchGPUCompute(compute_pass, 1, 1, 1);
+    SDL_EndGPUComputePass(compute_pass);
+    scheduler_submit(info->scheduler, info->gpu, command_buffer, SCHEDULER_WORK_GHOST, units);
+
+    trajectories->ghost.progress += units;
+}
 
-    for (u32 i = 0; i < PREDICTION_LENGTH; i++) {
-        SDL_PushGPUComputeUniformData(info->command_buffer, 1, &i, sizeof(i));
-        SDL_DispatchGPUCompute(info->compute_pass, trajectory_count, 1, 1);
+// only the selected and followed bodies' predictions are drawn, with the ghost's after them. a job started for a
+// new selection hasn't predicted the bodies just added, so they're left out until it's swapped in, while the ones
+// just removed go at once
+static void trajectories_list(Trajectories *trajectories, const TrajectoriesUpdateInfo *info) {
+    const TrajectoriesState *computed = &trajectories->computed;
+    const TrajectoriesDrawn drawn = {
+        .generation = trajectories->generation,
+        .selection_version = trajectories->selection.version,
+        .target = info->target,
+        .ghost = computed->ghost || trajectories->ghost.valid,
+        .valid = computed->valid
+    };
+    const TrajectoriesDrawn *previous = &trajectories->drawn;
+    const bool changed = previous->valid != drawn.valid
+        || previous->generation != drawn.generation
+        || previous->selection_version != drawn.selection_version
+        || previous->target != drawn.target
+        || previous->ghost != drawn.ghost;
+    if (!changed) return;
+    trajectories->drawn = drawn;
+    if (!drawn.valid) return;
+
+    // slots past the count are left over from an earlier job when this one had nothing to keep
+    const u32 *slots = trajectories->predicted.slots;
+    const u32 body_count = SDL_min(computed->body_count, (u32) arrlen(slots));
+    u32 *drawn_slots = NULL;
+    for (u32 i = 0; i < body_count; i++) {
+        if (slots[i] >= computed->count) continue;
+        if (i == drawn.target || selection_contains(&trajectories->selection, i)) arrput(drawn_slots, slots[i]);
     }
+    if (drawn.ghost) arrput(drawn_slots, computed->count);
+    trajectories->drawn.count = (u32) arrlen(drawn_slots);
+
+    if (trajectories->drawn.count) {
+        ReserveGPUArray(&trajectories->drawn_slots, info->gpu, trajectories->drawn.count * sizeof(u32));
+        SDL_GPUCommandBuffer *command_buffer = SDL_AcquireGPUCommandBuffer(info->gpu);
+        SDL_GPUCopyPass *copy_pass = SDL_BeginGPUCopyPass(command_buffer);
+        WriteToGPUBuffers(info->gpu, copy_pass, (WriteGPUBufferBinding[]) {
+            {
+                .buffer = trajectories->drawn_slots.buffer,
+                .source = (u8*) drawn_slots,
+                .size = trajectories->drawn.count * sizeof(u32)
+            }
+        }, 1);
+        SDL_EndGPUCopyPass(copy_pass);
+        SDL_SubmitGPUCommandBuffer(command_buffer);
+    }
+    arrfree(drawn_slots);
 }
 
-void trajectories_free(const Trajectories *trajectories, SDL_GPUDevice *gpu) {
-    SDL_ReleaseGPUComputePipeline(gpu, trajectories->pipeline);
-    SDL_ReleaseGPUBuffer(gpu, trajectories->positions.buffer);
-    SDL_ReleaseGPUBuffer(gpu, trajectories->velocities.buffer);
+void trajectories_update(Trajectories *trajectories, const TrajectoriesUpdateInfo *info) {
+    if (GPUResidencyExpired(&trajectories->residency, trajectories->options.enabled, RELEASE_DELAY))
+        trajectories_release(trajectories, info->gpu);
+    if (!trajectories->options.enabled) return;
+    if (!trajectories->residency.resident && trajectories_load(trajectories, info->gpu) != SDL_APP_CONTINUE) {
+        trajectories->options.enabled = false;
+        return;
+    }
+
+    trajectories_step(trajectories, info);
+    trajectories_ghost_update(trajectories, info);
+    trajectories_list(trajectories, info);
+}
+
+u32 trajectories_count(const Trajectories *trajectories) {
+    return trajectories->drawn.valid ? trajectories->drawn.count : 0;
+}
+
+u32 trajectories_slot(const Trajectories *trajectories, const u32 body) {
+    const u32 *slots = trajectories->predicted.slots;
+    if (!trajectories->computed.valid || body >= (u32) arrlen(slots)) return SELECTION_NONE;
+    return slots[body];
+}
+
+void trajectories_free(Trajectories *trajectories, SDL_GPUDevice *gpu) {
+    if (trajectories->residency.resident) trajectories_release(trajectories, gpu);
+    if (trajectories->residency.loaded) {
+        kernel_free(&trajectories->kernel, gpu);
+        kernel_free(&trajectories->ghost_kernel, gpu);
+    }
+    selection_free(&trajectories->selection);
 }